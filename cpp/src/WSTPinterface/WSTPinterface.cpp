@@ -46,6 +46,7 @@ namespace wstp {
 
 
     vector<pair<WSENV, WSLINK>> links;
+    mutex links_mutex;
 
     // The closing of the links is not working properly (at least during tests), so I'm commenting it out.
 
@@ -74,7 +75,10 @@ namespace wstp {
         lp = WSOpenArgv(ep, argv, argv + argc, &err);
         if (lp == (WSLINK)0) return {ep, lp};
 
-        links.push_back({ep, lp});
+        {
+            lock_guard<mutex> lock(links_mutex);
+            links.push_back({ep, lp});
+        }
 
         return {ep, lp};
     }
@@ -164,5 +168,14 @@ namespace wstp {
         return _WS_to_ast(lp);
     }
 
+    AST evaluate(WSLINK lp, const AST& ast) {
+        // all the links share one lock, since WSTP itself is not guaranteed to be thread-safe
+        static mutex evaluate_mutex;
+        lock_guard<mutex> lock(evaluate_mutex);
+
+        ast_to_WS(lp, ast);
+        return WS_to_ast(lp);
+    }
+
 
 } // namespace wstp
@@ -5,6 +5,7 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <mutex>
 
 #include "wstp.h"
 
@@ -27,6 +28,9 @@ namespace wstp {
 
     extern std::vector<std::pair<WSENV, WSLINK>> links;
 
+    // The mutex protecting `links`.
+    extern std::mutex links_mutex;
+
     std::pair<WSENV, WSLINK> init_and_openlink(int argc, char* argv[]);
 
     /**
@@ -45,4 +49,14 @@ namespace wstp {
      */
     astparser::AST WS_to_ast(WSLINK lp);
 
+    /**
+     * @brief Send the AST to the WSTP link for evaluation and read the result.
+     * A link serves one request at a time, so the round trip is serialized and can be used by several threads.
+     * 
+     * @param lp 
+     * @param ast 
+     * @return astparser::AST 
+     */
+    astparser::AST evaluate(WSLINK lp, const astparser::AST& ast);
+
 } // namespace wstp
\ No newline at end of file
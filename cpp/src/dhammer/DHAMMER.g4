@@ -18,6 +18,8 @@ cmd :   'Def' ID ':=' expr '.'         # Definition0
     |   'Normalize' expr '.'         # Normalize
     |   'Normalize' expr 'with' 'trace' '.'         # NormalizeTraced
     |   'CheckEq' expr 'with' expr '.'      # CheckEq
+    |   'Profile' '.'                  # Profile
+    |   'Profile' ID '.'               # ProfileCmd
     ;
 
 term:   ID '[' expr (',' expr)* ']'            # Application
@@ -94,27 +94,41 @@ namespace dhammer {
     ////////////////////////////////////////////
 
 
-    std::optional<Declaration> Kernel::find_in_env(int symbol) {
-        for (const auto& [sym, def] : env) {
-            if (sym == symbol) {
-                return def;
-            }
+    const Declaration* Kernel::find_in_env(int symbol) const {
+        if (symbol < 0 || symbol >= env_index.size() || env_index[symbol] == -1) {
+            return nullptr;
         }
-        return std::nullopt;
+        return &env[env_index[symbol]].second;
     }
 
-    std::optional<Declaration> Kernel::find_dec(int symbol) {
-        for (int i = ctx.size() - 1; i >= 0; i--) {
-            if (ctx[i].first == symbol) {
-                return ctx[i].second;
-            }
+    void Kernel::env_push(int symbol, const Declaration& dec) {
+        if (symbol >= env_index.size()) {
+            env_index.resize(symbol + 1, -1);
         }
-        for (const auto& [sym, def] : env) {
-            if (sym == symbol) {
-                return def;
-            }
+        env_index[symbol] = env.size();
+        env.push_back({symbol, dec});
+        env_version++;
+
+        // the declaration may contain the fresh variables created so far
+        fresh_var_floor = sig.get_fresh_var_mark();
+    }
+
+    int& Kernel::_ctx_index_slot(int symbol) {
+        auto& index = sig.is_fresh_var(symbol) ? fresh_ctx_index : ctx_index;
+        std::size_t pos = sig.is_fresh_var(symbol) ? symbol - sig.fresh_var_base : symbol;
+        if (pos >= index.size()) {
+            index.resize(pos + 1, -1);
+        }
+        return index[pos];
+    }
+
+    const Declaration* Kernel::find_dec(int symbol) const {
+        const auto& index = sig.is_fresh_var(symbol) ? fresh_ctx_index : ctx_index;
+        long long pos = sig.is_fresh_var(symbol) ? symbol - sig.fresh_var_base : symbol;
+        if (pos >= 0 && pos < index.size() && index[pos] != -1) {
+            return &ctx[index[pos]].second;
         }
-        return std::nullopt;
+        return find_in_env(symbol);
     }
 
     std::string Kernel::dec_to_string(const std::string& name, const Declaration& dec) const {
@@ -141,8 +155,12 @@ namespace dhammer {
         return sig.ast2term(ast);
     }
 
-    string Kernel::term_to_string(TermPtr<int> term) const {
-        return sig.term_to_string(term);
+    string Kernel::term_to_string(TermPtr<int> term, const PrintOptions& options) const {
+        return sig.term_to_string(term, options);
+    }
+
+    void Kernel::print_term(std::ostream& os, TermPtr<int> term, const PrintOptions& options) const {
+        sig.print_term(os, term, options);
     }
 
     string Kernel::env_to_string() const {
@@ -176,8 +194,27 @@ namespace dhammer {
 
 
     TermPtr<int> Kernel::calc_type(TermPtr<int> term) {
+        TermContextKey key{term, get_context_id()};
+
+        auto find_res = type_cache.find(key);
+        if (find_res != type_cache.end()) {
+            type_cache_stats.hits++;
+            return find_res->second;
+        }
+        type_cache_stats.misses++;
+
+        auto type = _calc_type(term);
+
+        if (type_cache.size() >= type_cache_limit) {
+            type_cache.clear();
+        }
+        type_cache[key] = type;
+        return type;
+    }
+
+    TermPtr<int> Kernel::_calc_type(TermPtr<int> term) {
         auto head = term->get_head();
-        auto args = term->get_args();
+        auto& args = term->get_args();
 
         // Preprocessing (COMPO rules)
         if (head == COMPO) {
@@ -280,10 +317,10 @@ namespace dhammer {
             if (typeA->get_head() == DTYPE) {
                 arg_number_check(args, 2);
 
-                auto type_X1 = calc_type(args[0]);
+                auto& type_X1 = typeA;
                 auto type_X1_head = type_X1->get_head();
                 auto& args_X1 = type_X1->get_args();
-                auto type_X2 = calc_type(args[1]);
+                auto& type_X2 = typeB;
                 auto type_X2_head = type_X2->get_head();
                 auto& args_X2 = type_X2->get_args();
 
@@ -387,7 +424,7 @@ namespace dhammer {
             if (typeFirst->get_head() == DTYPE) {
                 arg_number_check(args, 2);
 
-                auto type_X1 = calc_type(args[0]);
+                auto& type_X1 = typeFirst;
                 auto type_X1_head = type_X1->get_head();
                 auto& args_X1 = type_X1->get_args();
                 auto type_X2 = calc_type(args[1]);
@@ -1378,7 +1415,7 @@ namespace dhammer {
         if (term->is_atomic()) {
 
             auto dec_find = find_dec(term->get_head());
-            if (dec_find != std::nullopt) {
+            if (dec_find != nullptr) {
                 return dec_find->type;
             }
         }
@@ -1394,23 +1431,23 @@ namespace dhammer {
         if (is_reserved(symbol)) {
             throw std::runtime_error("The symbol '" + sig.term_to_string(create_term(symbol)) + "' is reserved.");
         }
-        if (find_in_env(symbol) != std::nullopt) {
+        if (find_in_env(symbol) != nullptr) {
             throw std::runtime_error("The symbol '" + sig.term_to_string(create_term(symbol)) + "' is already in the environment.");
         }
 
         // W-Assum-INDEX
         if (*type == Term<int>(INDEX)) {
-            env.push_back({symbol, {std::nullopt, type}});
+            env_push(symbol, {std::nullopt, type});
         }
 
         // W-Assum-TYPE
         else if (*type == Term<int>(TYPE)) {
-            env.push_back({symbol, {std::nullopt, type}});
+            env_push(symbol, {std::nullopt, type});
         }
 
         // W-Assum-Reg
         else if (type->get_head() == REG && type->get_args().size() == 1 && is_index(type->get_args()[0])) {
-            env.push_back({symbol, {std::nullopt, type}});
+            env_push(symbol, {std::nullopt, type});
         }
 
         // W-Assum-Term
@@ -1418,8 +1455,11 @@ namespace dhammer {
             if (!is_type(type)) {
                 throw std::runtime_error("The type of the symbol '" + sig.term_to_string(create_term(symbol)) + "' is not a well-typed type.");
             }
-            env.push_back({symbol, {std::nullopt, type}});
+            env_push(symbol, {std::nullopt, type});
         }
+
+        // the types and normal forms of the terms containing the symbol are changed
+        invalidate_caches();
     }
 
     void Kernel::def(int symbol, TermPtr<int> term, std::optional<TermPtr<int>> type) {
@@ -1431,7 +1471,7 @@ namespace dhammer {
             throw std::runtime_error("The context is not empty.");
         }
 
-        if (find_in_env(symbol) != std::nullopt) {
+        if (find_in_env(symbol) != nullptr) {
             throw std::runtime_error("The symbol '" + sig.term_to_string(create_term(symbol)) + "' is already in the environment."); 
         }
 
@@ -1448,14 +1488,20 @@ namespace dhammer {
         else {
             type = deducted_type;
         }
-        env.push_back({symbol, {term, type.value()}});
+        env_push(symbol, {term, type.value()});
+
+        invalidate_caches();
     }
 
     void Kernel::env_pop() {
         if (env.size() == 0) {
             throw std::runtime_error("The environment is empty.");
         }
+        env_index[env.back().first] = -1;
         env.pop_back();
+        env_version++;
+
+        invalidate_caches();
     }
 
 
@@ -1465,21 +1511,97 @@ namespace dhammer {
             throw std::runtime_error("The term '" + sig.term_to_string(type) + "' is not a valid type for bound index.");
         }
 
+        auto& slot = _ctx_index_slot(symbol);
+        ctx_shadowed.push_back(slot);
+        slot = ctx.size();
         ctx.push_back({symbol, {std::nullopt, type}});
+
+        // get the id of the new context
+        auto key = std::make_tuple(ctx_ids.back(), symbol, type.get());
+        auto find_res = ctx_id_table.find(key);
+        if (find_res != ctx_id_table.end()) {
+            ctx_ids.push_back(find_res->second);
+        }
+        else {
+            // keep the type alive, so that its address is not reused by another term
+            ctx_id_types.push_back(type);
+            int new_id = ctx_id_table.size() + 1;
+            ctx_id_table[key] = new_id;
+            ctx_ids.push_back(new_id);
+        }
     }
 
     void Kernel::context_pop() {
         if (ctx.size() == 0) {
             throw std::runtime_error("The context is empty.");
         }
+        _ctx_index_slot(ctx.back().first) = ctx_shadowed.back();
+        ctx_shadowed.pop_back();
         ctx.pop_back();
+        ctx_ids.pop_back();
+    }
+
+
+    TermPtr<int> Kernel::_normal_form(TermPtr<int> term, RewriteStrategy strategy) {
+        if (!nf_cache_enabled) {
+            return to_deBruijn(sig, pos_rewrite_repeated(*this, term, rules, static_cast<TraceSink*>(nullptr), strategy));
+        }
+
+        auto& cache = nf_cache[static_cast<std::size_t>(strategy)];
+        TermContextKey key{term, get_context_id()};
+
+        auto find_res = cache.find(key);
+        if (find_res != cache.end()) {
+            nf_cache_stats.hits++;
+            return find_res->second;
+        }
+
+#if DHAMMER_LOCALLY_NAMELESS
+        // alpha equivalent terms share the entry of their locally nameless form
+        TermContextKey ln_key{to_locally_nameless(term), key.context_id};
+        if (ln_key.term != term) {
+            find_res = cache.find(ln_key);
+            if (find_res != cache.end()) {
+                nf_cache_stats.hits++;
+                auto nf = find_res->second;
+                cache[key] = nf;
+                return nf;
+            }
+        }
+#endif
+        nf_cache_stats.misses++;
+
+        auto nf = to_deBruijn(sig, pos_rewrite_repeated(*this, term, rules, static_cast<TraceSink*>(nullptr), strategy));
+
+        if (cache.size() + 1 >= nf_cache_limit) {
+            cache.clear();
+        }
+        cache[key] = nf;
+#if DHAMMER_LOCALLY_NAMELESS
+        if (ln_key.term != term) {
+            cache[ln_key] = nf;
+        }
+#endif
+        return nf;
     }
 
+    TermPtr<int> Kernel::normal_form(TermPtr<int> term, RewriteStrategy strategy) {
+        return _normal_form(term, strategy);
+    }
+
+    bool Kernel::is_judgemental_eq(TermPtr<int> termA, TermPtr<int> termB, RewriteStrategy strategy) {
+        // the terms are hash-consed, so syntactically equal terms are usually the same object
+        if (*termA == *termB) {
+            return true;
+        }
 
-    bool Kernel::is_judgemental_eq(TermPtr<int> termA, TermPtr<int> termB) {
-        auto reduced_A = pos_rewrite_repeated(*this, termA, rules);
-        auto reduced_B = pos_rewrite_repeated(*this, termB, rules);
-        return is_eq(sig, reduced_A, reduced_B);
+        // alpha equivalent terms meet at the cache entry of their locally nameless form
+        auto nf_A = _normal_form(termA, strategy);
+        auto nf_B = _normal_form(termB, strategy);
+        if (*nf_A == *nf_B) {
+            return true;
+        }
+        return is_eq_modulo_rset(nf_A, nf_B);
     }
 
     
@@ -4,6 +4,10 @@
 #include "ualg.hpp"
 #include "WSTPinterface.hpp"
 
+#include <array>
+#include <tuple>
+#include <unordered_map>
+
 namespace dhammer {
 
     /**
@@ -49,6 +53,46 @@ namespace dhammer {
         }
     };
 
+    /**
+     * @brief The key of a term visited under a binder context. The context is identified by the id assigned by the kernel.
+     */
+    struct TermContextKey {
+        ualg::TermPtr<int> term;
+        int context_id;
+
+        inline bool operator == (const TermContextKey& other) const {
+            return term == other.term && context_id == other.context_id;
+        }
+    };
+
+    struct TermContextKeyHash {
+        inline std::size_t operator()(const TermContextKey& key) const {
+            return key.term->get_hash() ^ (std::size_t(key.context_id) * 0x9e3779b97f4a7c15ULL);
+        }
+    };
+
+    /**
+     * @brief The hit/miss counters of a cache.
+     */
+    struct CacheStats {
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+    };
+
+    /**
+     * @brief The strategies to choose the redexes in pos_rewrite_repeated.
+     */
+    enum class RewriteStrategy {
+        // Rewrite the leftmost-outermost redex, and search again from the root.
+        LEFTMOST_OUTERMOST,
+        // Normalize the arguments before the term itself. After a rewriting, only the result is normalized again.
+        INNERMOST,
+        // Rewrite all the outermost redexes in one sweep, and repeat the sweeps until no redex is left.
+        PARALLEL_OUTERMOST,
+    };
+
+    constexpr std::size_t rewrite_strategy_num = 3;
+
     /** 
      * @brief The kernel of the proof assistant.
      * 
@@ -63,7 +107,93 @@ namespace dhammer {
         std::vector<std::pair<int, Declaration>> env;
         std::vector<std::pair<int, Declaration>> ctx;
 
-        inline void arg_number_check(const ualg::ListArgs<int>& args, int num) {
+        // The position of each symbol in env, indexed by the symbol. -1 means not declared.
+        std::vector<int> env_index;
+        // The position of the innermost declaration of each symbol in ctx, indexed by the symbol. -1 means not bound.
+        std::vector<int> ctx_index;
+        // The same as ctx_index for the fresh variables, indexed by their offsets to Signature::fresh_var_base.
+        std::vector<int> fresh_ctx_index;
+        // For each position in ctx, the position of the declaration it shadows.
+        std::vector<int> ctx_shadowed;
+
+        // The context ids. Every chain of (symbol, type) pushes gets an id, and the empty context has the id 0.
+        std::map<std::tuple<int, int, const ualg::Term<int>*>, int> ctx_id_table;
+        std::vector<ualg::TermPtr<int>> ctx_id_types;
+        std::vector<int> ctx_ids = {0};
+
+        // The cache of calc_type. It is valid for the current environment, and the entries are indexed by the context id.
+        std::unordered_map<TermContextKey, ualg::TermPtr<int>, TermContextKeyHash> type_cache;
+        CacheStats type_cache_stats;
+
+        static constexpr std::size_t type_cache_limit = 1 << 16;
+
+        // The caches of the normal forms (in de Bruijn representation) used by is_judgemental_eq, one for each
+        // rewriting strategy. Same validity as type_cache.
+        std::array<std::unordered_map<TermContextKey, ualg::TermPtr<int>, TermContextKeyHash>, rewrite_strategy_num> nf_cache;
+        CacheStats nf_cache_stats;
+        bool nf_cache_enabled = true;
+
+        static constexpr std::size_t nf_cache_limit = 1 << 16;
+
+        // The number of the changes of env, so that the copies of the kernel can tell whether they are outdated.
+        std::size_t env_version = 0;
+
+        // The number of rewriting steps performed with this kernel.
+        std::size_t rewrite_steps = 0;
+
+        // The reuses of the memoized normal forms in the innermost rewriting, which are not rewriting steps.
+        CacheStats innermost_memo_stats;
+
+        // The fresh variables below this mark may be kept in env, so they are never reclaimed.
+        long long fresh_var_floor = 0;
+
+        ualg::TermPtr<int> _calc_type(ualg::TermPtr<int> term);
+
+        /**
+         * @brief Calculate the normal form of the term through the normal form cache. The cache is probed with the term
+         * first, and only on a miss with its locally nameless form, under which alpha equivalent terms share the entry.
+         */
+        ualg::TermPtr<int> _normal_form(ualg::TermPtr<int> term, RewriteStrategy strategy);
+
+        /**
+         * @brief Append the declaration to env and index it. The symbol should not be declared in env yet.
+         */
+        void env_push(int symbol, const Declaration& dec);
+
+        /**
+         * @brief Return the slot of ctx_index, or fresh_ctx_index for the fresh variables, of the symbol. The index is
+         * extended to hold the symbol.
+         */
+        int& _ctx_index_slot(int symbol);
+
+        /**
+         * @brief Clear all the caches depending on the environment.
+         */
+        inline void invalidate_caches() {
+            type_cache.clear();
+            clear_nf_cache();
+            _clear_context_ids();
+        }
+
+        /**
+         * @brief Forget the ids of the non-empty contexts when no context is live, so that the id table does not grow over
+         * the commands. The cache entries keyed by these ids are dropped with them, since the ids will be reused.
+         */
+        inline void _clear_context_ids() {
+            if (!ctx.empty() || ctx_id_table.empty()) {
+                return;
+            }
+            ctx_id_table.clear();
+            ctx_id_types.clear();
+
+            auto in_context = [](const auto& entry) { return entry.first.context_id != 0; };
+            std::erase_if(type_cache, in_context);
+            for (auto& cache : nf_cache) {
+                std::erase_if(cache, in_context);
+            }
+        }
+
+        inline void arg_number_check(const ualg::TermArgs<int>& args, int num) {
             if (args.size() != num) {
                 throw std::runtime_error("Typing error: the term is not well-typed, because the argument number is not " + std::to_string(num) + ".");
             }
@@ -75,10 +205,22 @@ namespace dhammer {
         Kernel(WSLINK _lp) : lp(_lp), sig(dhammer_sig) {}
 
         // copy constructor
-        Kernel(const Kernel& other) : lp(other.lp), sig(other.sig), env(other.env), ctx(other.ctx) {}
+        Kernel(const Kernel& other) : lp(other.lp), sig(other.sig), env(other.env), ctx(other.ctx),
+            env_index(other.env_index), ctx_index(other.ctx_index), fresh_ctx_index(other.fresh_ctx_index), ctx_shadowed(other.ctx_shadowed),
+            ctx_id_table(other.ctx_id_table), ctx_id_types(other.ctx_id_types), ctx_ids(other.ctx_ids),
+            type_cache(other.type_cache), type_cache_stats(other.type_cache_stats),
+            nf_cache(other.nf_cache), nf_cache_stats(other.nf_cache_stats), nf_cache_enabled(other.nf_cache_enabled),
+            env_version(other.env_version), rewrite_steps(other.rewrite_steps), innermost_memo_stats(other.innermost_memo_stats),
+            fresh_var_floor(other.fresh_var_floor) {}
 
         // move constructor
-        Kernel(Kernel&& other) : lp(std::move(other.lp)), sig(std::move(other.sig)), env(std::move(other.env)), ctx(std::move(other.ctx)) {}
+        Kernel(Kernel&& other) : lp(std::move(other.lp)), sig(std::move(other.sig)), env(std::move(other.env)), ctx(std::move(other.ctx)),
+            env_index(std::move(other.env_index)), ctx_index(std::move(other.ctx_index)), fresh_ctx_index(std::move(other.fresh_ctx_index)), ctx_shadowed(std::move(other.ctx_shadowed)),
+            ctx_id_table(std::move(other.ctx_id_table)), ctx_id_types(std::move(other.ctx_id_types)), ctx_ids(std::move(other.ctx_ids)),
+            type_cache(std::move(other.type_cache)), type_cache_stats(other.type_cache_stats),
+            nf_cache(std::move(other.nf_cache)), nf_cache_stats(other.nf_cache_stats), nf_cache_enabled(other.nf_cache_enabled),
+            env_version(other.env_version), rewrite_steps(other.rewrite_steps), innermost_memo_stats(other.innermost_memo_stats),
+            fresh_var_floor(other.fresh_var_floor) {}
 
         inline bool wolfram_connected() {
             return lp != nullptr;
@@ -96,15 +238,23 @@ namespace dhammer {
             return sig;
         }
 
+        /**
+         * @brief Get the id of the current context. Equal ids mean the same sequence of bound variables and types.
+         */
+        inline int get_context_id() const {
+            return ctx_ids.back();
+        }
+
         /**
          * @brief Find the assumption/definition of the symbol in the env and context, following the shadowing principle.
+         * The returned pointer is valid until the env or context is modified.
          * 
          * @param symbol 
-         * @return std::optional<Declaration> If the symbol is not found, return `std::nullopt`.
+         * @return const Declaration* If the symbol is not found, return `nullptr`.
          */
-        std::optional<Declaration> find_dec(int symbol);
+        const Declaration* find_dec(int symbol) const;
 
-        std::optional<Declaration> find_in_env(int symbol);
+        const Declaration* find_in_env(int symbol) const;
 
         std::string dec_to_string(const std::string& name, const Declaration& dec) const;
     
@@ -133,7 +283,12 @@ namespace dhammer {
          * @param term 
          * @return string 
          */
-        std::string term_to_string(ualg::TermPtr<int> term) const;
+        std::string term_to_string(ualg::TermPtr<int> term, const ualg::PrintOptions& options = {}) const;
+
+        /**
+         * @brief Write the term to the output stream, without building the whole string first.
+         */
+        void print_term(std::ostream& os, ualg::TermPtr<int> term, const ualg::PrintOptions& options = {}) const;
 
         std::string env_to_string() const;
 
@@ -158,23 +313,91 @@ namespace dhammer {
         /**
          * @brief Calculate and return the least type of the term.
          * 
-         * Raise an error if the term is not well-typed.
+         * Raise an error if the term is not well-typed. The results are cached for the current environment and context.
          * 
          * @param term 
          * @return const ualg::Term<int>* , the least type of the term.
          */
         ualg::TermPtr<int> calc_type(ualg::TermPtr<int> term);
 
+        inline const CacheStats& get_type_cache_stats() const {
+            return type_cache_stats;
+        }
+
+        inline void clear_type_cache() {
+            type_cache.clear();
+        }
+
+        /**
+         * @brief Reclaim the fresh variables created since the last declaration, so that the later fresh variables
+         * reuse their ids. It is called between the top-level commands, and the terms of the previous commands should
+         * not be used afterwards. The type cache is cleared, because the types in it may contain the reclaimed variables.
+         * The context ids are forgotten as well, since the binders of the fresh variables make new contexts every command.
+         */
+        inline void reclaim_fresh_vars() {
+            if (sig.get_fresh_var_mark() > fresh_var_floor) {
+                sig.reclaim_fresh_vars(fresh_var_floor);
+                type_cache.clear();
+            }
+            _clear_context_ids();
+        }
+
+        inline std::size_t get_env_version() const {
+            return env_version;
+        }
+
+        inline void count_rewrite_step() {
+            rewrite_steps++;
+        }
+
+        inline std::size_t get_rewrite_steps() const {
+            return rewrite_steps;
+        }
+
+        inline CacheStats& get_innermost_memo_stats() {
+            return innermost_memo_stats;
+        }
+
+        inline const CacheStats& get_nf_cache_stats() const {
+            return nf_cache_stats;
+        }
+
+        inline void clear_nf_cache() {
+            for (auto& cache : nf_cache) {
+                cache.clear();
+            }
+        }
+
+        /**
+         * @brief Enable or disable the normal form cache of is_judgemental_eq. It is enabled by default.
+         */
+        inline void set_nf_cache_enabled(bool enabled) {
+            nf_cache_enabled = enabled;
+            clear_nf_cache();
+        }
+
+        /**
+         * @brief Calculate the normal form of the term under the reduction rules, in the de Bruijn representation.
+         * The results are cached for the current environment and context, and alpha equivalent terms share the entries
+         * unless DHAMMER_LOCALLY_NAMELESS is 0.
+         * 
+         * @param term 
+         * @param strategy The rewriting strategy.
+         * @return ualg::TermPtr<int> 
+         */
+        ualg::TermPtr<int> normal_form(ualg::TermPtr<int> term, RewriteStrategy strategy = RewriteStrategy::LEFTMOST_OUTERMOST);
 
         /**
          * @brief Check whether two terms are equivalent under the reduction rules and alpha equivalence.
+         * Identical terms are equivalent directly, and the normal forms are cached.
          * 
          * @param termA 
          * @param termB 
+         * @param strategy The rewriting strategy to calculate the normal forms.
          * @return true 
          * @return false 
          */
-        bool is_judgemental_eq(ualg::TermPtr<int> termA, ualg::TermPtr<int> termB);
+        bool is_judgemental_eq(ualg::TermPtr<int> termA, ualg::TermPtr<int> termB, RewriteStrategy strategy = RewriteStrategy::LEFTMOST_OUTERMOST);
 
 
         /**
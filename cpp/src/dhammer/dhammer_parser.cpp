@@ -26,6 +26,8 @@ namespace dhammer {
         void exitNormalize(DHAMMERParser::NormalizeContext *ctx) override;
         void exitNormalizeTraced(DHAMMERParser::NormalizeTracedContext *ctx) override;
         void exitCheckEq(DHAMMERParser::CheckEqContext *ctx) override;
+        void exitProfile(DHAMMERParser::ProfileContext *ctx) override;
+        void exitProfileCmd(DHAMMERParser::ProfileCmdContext *ctx) override;
 
         // term
         void exitBra(DHAMMERParser::BraContext *ctx) override;
@@ -198,6 +200,18 @@ namespace dhammer {
         node_stack.push(AST{"CHECKEQ", {std::move(lhs), std::move(rhs)}});
     }
 
+    void DHAMMERBuilder::exitProfile(DHAMMERParser::ProfileContext *ctx) {
+        // Create and push the profile node
+        node_stack.push(AST{"PROFILE", {}});
+    }
+
+    void DHAMMERBuilder::exitProfileCmd(DHAMMERParser::ProfileCmdContext *ctx) {
+        std::string option = ctx->ID()->getText();
+
+        // Create and push the profile node with the option
+        node_stack.push(AST{"PROFILE", {AST{option, {}}}});
+    }
+
     ///////////////////////////////////////////
     // term
 
@@ -5,7 +5,22 @@ namespace dhammer {
     using namespace ualg;
 
 
-    inline TermPtr<int> rewrite_with_wolfram(Kernel& kernel, TermPtr<int> term, vector<PosReplaceRecord>& trace, bool distribute) {
+    /**
+     * @brief Report a pass of the normalization, which replaces the whole term, to the sink.
+     */
+    inline void trace_pass(TraceSink* trace, std::string_view step, const TermPtr<int>& init_term, const TermPtr<int>& final_term) {
+        if (trace == nullptr) {
+            return;
+        }
+        if (trace->wants_records()) {
+            trace->record({string(step), {}, init_term, nullptr, nullptr, final_term});
+        }
+        else {
+            trace->count(step);
+        }
+    }
+
+    inline TermPtr<int> rewrite_with_wolfram(Kernel& kernel, TermPtr<int> term, TraceSink* trace, bool distribute, RewriteStrategy strategy) {
         auto temp = term;
 
         // use different rules depending on the wolfram connection
@@ -13,22 +28,15 @@ namespace dhammer {
         if (kernel.wolfram_connected()) {
             while (true) {
                 if (distribute) {
-                    temp = pos_rewrite_repeated(kernel, temp, rules_with_wolfram_distr, &trace);
+                    temp = pos_rewrite_repeated(kernel, temp, rules_with_wolfram_distr, trace, strategy);
                 }
                 else {
-                    temp = pos_rewrite_repeated(kernel, temp, rules_with_wolfram_merge, &trace);
+                    temp = pos_rewrite_repeated(kernel, temp, rules_with_wolfram_merge, trace, strategy);
                 }
 
                 auto wolfram_simplified = wolfram_fullsimplify(kernel, temp, distribute);
 
-                trace.push_back({
-                    "Wolfram Engine",
-                    {},
-                    temp,
-                    nullptr,
-                    nullptr,
-                    wolfram_simplified
-                });
+                trace_pass(trace, "Wolfram Engine", temp, wolfram_simplified);
 
                 if (*temp == *wolfram_simplified) {
                     break;
@@ -39,7 +47,7 @@ namespace dhammer {
             return temp;
         }
         else {
-            return pos_rewrite_repeated(kernel, temp, rules, &trace);
+            return pos_rewrite_repeated(kernel, temp, rules, trace, strategy);
         }
     }
 
@@ -66,9 +74,7 @@ namespace dhammer {
                 })
             });
 
-            wstp::ast_to_WS(kernel.get_wstp_link(), request);
-
-            auto response = wstp::WS_to_ast(kernel.get_wstp_link());
+            auto response = wstp::evaluate(kernel.get_wstp_link(), request);
 
             if (response == AST("True")) {
                 return true;
@@ -79,66 +85,31 @@ namespace dhammer {
     }
 
 
-    TermPtr<int> normalize(Kernel& kernel, TermPtr<int> term, vector<PosReplaceRecord>& trace, bool distribute) {
+    TermPtr<int> normalize(Kernel& kernel, TermPtr<int> term, TraceSink* trace, bool distribute, RewriteStrategy strategy) {
 
         // rename to unique variables first
         auto temp = bound_variable_rename(kernel, term);
-        trace.push_back({
-            "Bound Variable Rename",
-            {},
-            term,
-            nullptr,
-            nullptr,
-            temp
-        });
+        trace_pass(trace, "Bound Variable Rename", term, temp);
 
         // first rewriting
-        temp = rewrite_with_wolfram(kernel, temp, trace, distribute);
+        temp = rewrite_with_wolfram(kernel, temp, trace, distribute, strategy);
 
         // expand on variables
-        temp = variable_expand(kernel, temp);
-        trace.push_back({
-            "Variable Expand",
-            {},
-            term,
-            nullptr,
-            nullptr,
-            temp
-        });
+        auto expanded = variable_expand(kernel, temp);
+        trace_pass(trace, "Variable Expand", temp, expanded);
 
         // second rewriting
-        temp = rewrite_with_wolfram(kernel, temp, trace, distribute);
+        temp = rewrite_with_wolfram(kernel, expanded, trace, distribute, strategy);
         
-        temp = sort_modulo_bound(kernel, temp);
-        trace.push_back({
-            "Sort Modulo Bound Variables",
-            {},
-            term,
-            nullptr,
-            nullptr,
-            temp
-        });
+        auto sorted = sort_modulo_bound(kernel, temp);
+        trace_pass(trace, "Sort Modulo Bound Variables", temp, sorted);
 
         // reduce to sum_swap normal form
-        temp = sum_swap_normalization(kernel, temp);
-        trace.push_back({
-            "Sum Swap Normalization",
-            {},
-            term,
-            nullptr,
-            nullptr,
-            temp
-        });
+        temp = sum_swap_normalization(kernel, sorted);
+        trace_pass(trace, "Sum Swap Normalization", sorted, temp);
 
         auto normalized_term = deBruijn_normalize(kernel, temp);
-        trace.push_back({
-            "DeBruijn Normalize",
-            {},
-            term,
-            nullptr,
-            nullptr,
-            normalized_term
-        });
+        trace_pass(trace, "DeBruijn Normalize", temp, normalized_term);
         
         return normalized_term;
     }
@@ -154,7 +125,14 @@ namespace dhammer {
                 }
                 return true;
             }
-            else if (ast.head == "DEF") {
+
+            // the fresh variables of the previous commands are no longer used, and neither are the terms in the trace log
+            kernel.reclaim_fresh_vars();
+            if (trace_log != nullptr) {
+                trace_log->checkpoint();
+            }
+
+            if (ast.head == "DEF") {
                 // DEF(x t)
                 if (ast.children.size() == 2) {
                     if (!check_id(ast.children[0])) return false;
@@ -225,11 +203,11 @@ namespace dhammer {
                     try {
                         // get the definition in the env
                         auto find_def = kernel.find_in_env(kernel.register_symbol(name));
-                        if (find_def == nullopt) {
+                        if (find_def == nullptr) {
                             output << "Error: the symbol '" << name << "' is not defined." << endl;
                             return false;
                         }
-                        output << kernel.dec_to_string(name, find_def.value()) << endl;
+                        output << kernel.dec_to_string(name, *find_def) << endl;
 
                         return true;
                     }
@@ -269,24 +247,28 @@ namespace dhammer {
                 auto term = kernel.parse(ast.children[0]);
                 auto type = kernel.calc_type(term);
 
-                // calculate the normalized term
+                // calculate the normalized term. The records are kept in memory only for the trace output.
                 vector<PosReplaceRecord> trace;
+                RecordSink record_sink(trace);
 
                 try {
 
-                    auto final_term = normalize(kernel, term, trace, true);
+                    auto final_term = normalize(kernel, term, ast.children.size() == 2 ? &record_sink : get_trace_sink(), true, rewrite_strategy);
 
                     // if output trace
                     if (ast.children.size() == 2) {
                         output << "[Trace]" << endl;
                         for (int i = 0; i < trace.size(); ++i) {
                             output << "# " << i << endl;
-                            output << record_to_string(kernel, trace[i]) << endl;
+                            print_record(output, kernel, trace[i], print_options);
+                            output << endl;
                         }
                     }
                     
                     // Output the normalized term
-                    output << "[Normal Form]" << kernel.term_to_string(final_term) + " : " + kernel.term_to_string(type)  << endl;
+                    output << "[Normal Form]";
+                    kernel.print_term(output, final_term, print_options);
+                    output << " : " << kernel.term_to_string(type) << endl;
 
                     return true;
 
@@ -297,7 +279,8 @@ namespace dhammer {
                         output << "[Trace]" << endl;
                         for (int i = 0; i < trace.size(); ++i) {
                             output << "# " << i << endl;
-                            output << record_to_string(kernel, trace[i]) << endl;
+                            print_record(output, kernel, trace[i], print_options);
+                            output << endl;
                         }
                     }
 
@@ -313,6 +296,41 @@ namespace dhammer {
                 check_eq(ast.children[0], ast.children[1]);
                 return true;
             }
+            // PROFILE
+            else if (ast.head == "PROFILE") {
+                auto& profiler = get_rule_profiler();
+
+                if (ast.children.size() == 0) {
+                    if (!DHAMMER_RULE_PROFILING) {
+                        output << "Profile: the profiling counters are not compiled (DHAMMER_RULE_PROFILING)." << endl;
+                    }
+                    else if (!profiler.is_enabled()) {
+                        output << "Profile: the profiling is off. Use 'Profile on.' to start it." << endl;
+                    }
+                    output << "[Profile]" << endl;
+                    output << profiler.to_string();
+                    return true;
+                }
+
+                if (ast.children.size() == 1 && ast.children[0].children.size() == 0) {
+                    auto& option = ast.children[0].head;
+                    if (option == "reset") {
+                        profiler.reset();
+                        return true;
+                    }
+                    else if (option == "on") {
+                        profiler.set_enabled(true);
+                        return true;
+                    }
+                    else if (option == "off") {
+                        profiler.set_enabled(false);
+                        return true;
+                    }
+                }
+
+                output << "Error: the PROFILE option should be 'reset', 'on' or 'off'." << endl;
+                return false;
+            }
         }
         catch (const exception& e) {
             output << "Error: " << e.what() << endl;
@@ -327,6 +345,12 @@ namespace dhammer {
 
     bool Prover::check_eq(const astparser::AST& codeA, const astparser::AST& codeB) {
         
+        // the fresh variables of the previous commands are no longer used, and neither are the terms in the trace log
+        kernel.reclaim_fresh_vars();
+        if (trace_log != nullptr) {
+            trace_log->checkpoint();
+        }
+
         // Typecheck the terms
         auto termA = kernel.parse(codeA);
         auto termB = kernel.parse(codeB);
@@ -340,41 +364,180 @@ namespace dhammer {
         }
 
         // calculate the normalized term
-        vector<PosReplaceRecord> traceA;
-        vector<PosReplaceRecord> traceB;
-        TermPtr<int> final_termA;
-        TermPtr<int> final_termB;
+        // the binary trace log is written by one thread
+        bool concurrent = concurrent_check_eq && trace_level != TraceLevel::FULL;
+        if (concurrent) {
+            sync_worker_kernel();
+        }
 
-        final_termA = normalize(kernel, termA, traceA, true);
-        final_termB = normalize(kernel, termB, traceB, true);
+        auto [final_termA, final_termB] = normalize_pair(termA, termB, true, concurrent);
         
         // Output the result
         if (syntax_eq_with_wolfram(kernel, final_termA, final_termB)) {
             output << "The two terms are equal." << endl;
-            output << "[Normalized Term] " << kernel.term_to_string(final_termA) << " : " << kernel.term_to_string(typeA) << endl;
+            output << "[Normalized Term] ";
+            kernel.print_term(output, final_termA, print_options);
+            output << " : " << kernel.term_to_string(typeA) << endl;
             return true;
         }
 
-        traceA = {};
-        traceB = {};
-        final_termA = normalize(kernel, termA, traceA, false);
-        final_termB = normalize(kernel, termB, traceB, false);
+        std::tie(final_termA, final_termB) = normalize_pair(termA, termB, false, concurrent);
 
         if (syntax_eq_with_wolfram(kernel, final_termA, final_termB)) {
             output << "The two terms are equal." << endl;
-            output << "[Normalized Term] " << kernel.term_to_string(final_termA) << " : " << kernel.term_to_string(typeA) << endl;
+            output << "[Normalized Term] ";
+            kernel.print_term(output, final_termA, print_options);
+            output << " : " << kernel.term_to_string(typeA) << endl;
             return true;
         }
 
         output << "The two terms are not equal." << endl;
-        output << "[Normalized Term A] " << kernel.term_to_string(final_termA) << " : " << kernel.term_to_string(typeA) << endl;
-        output << "[Normalized Term B] " << kernel.term_to_string(final_termB) << " : " << kernel.term_to_string(typeB) << endl;
+        output << "[Normalized Term A] ";
+        kernel.print_term(output, final_termA, print_options);
+        output << " : " << kernel.term_to_string(typeA) << endl;
+        output << "[Normalized Term B] ";
+        kernel.print_term(output, final_termB, print_options);
+        output << " : " << kernel.term_to_string(typeB) << endl;
+        return false;
+    }
+
+    Kernel& Prover::sync_worker_kernel() {
+        auto& sig = kernel.get_sig();
+        if (!worker_kernel.has_value() || worker_env_version != kernel.get_env_version() || worker_kernel->get_sig().get_symbol_num() != worker_symbol_num) {
+            worker_kernel.emplace(kernel);
+        }
+        else {
+            // the symbols are numbered in the order of registration, so they get the same ids in the worker
+            auto& worker_sig = worker_kernel->get_sig();
+            for (auto symbol = worker_symbol_num; symbol < sig.get_symbol_num(); symbol++) {
+                worker_sig.register_symbol(sig.get_name(symbol));
+            }
+            // the fresh variables created by the worker should not be in use by `kernel`
+            worker_kernel->reclaim_fresh_vars();
+            // Both kernels take the fresh variables after this mark at the same time, so the two sides may use the same
+            // ids. It is safe because the normal forms are in the de Bruijn representation without fresh variables,
+            // which normalize_pair checks. A disjoint range would grow the tables indexed by the fresh variables.
+            worker_sig.continue_fresh_vars(sig.get_fresh_var_mark());
+        }
+        worker_env_version = kernel.get_env_version();
+        worker_symbol_num = sig.get_symbol_num();
+        return *worker_kernel;
+    }
+
+    TermPtr<int> _rename_symbols(const TermPtr<int>& term, std::size_t symbol_num, Signature<int>& from, Signature<int>& to) {
+        auto head = term->get_head();
+        if (head >= 0 && static_cast<std::size_t>(head) >= symbol_num && !from.is_fresh_var(head)) {
+            head = to.register_symbol(from.get_name(head));
+        }
+
+        const auto& args = term->get_args();
+        if (args.empty()) {
+            return head == term->get_head() ? term : create_term(head);
+        }
+
+        bool changed = head != term->get_head();
+        ListArgs<int> new_args;
+        for (const auto& arg : args) {
+            new_args.push_back(_rename_symbols(arg, symbol_num, from, to));
+            changed = changed || new_args.back() != arg;
+        }
+        return changed ? create_term(head, std::move(new_args)) : term;
+    }
+
+    bool _contains_fresh_var(TermRef<int> term, const Signature<int>& sig, std::unordered_set<const Term<int>*>& visited) {
+        if (sig.is_fresh_var(term.get_head())) {
+            return true;
+        }
+        // the shared subterms are checked once
+        if (term.is_atomic() || !visited.insert(&term).second) {
+            return false;
+        }
+        for (const auto& arg : term.get_args()) {
+            if (_contains_fresh_var(*arg, sig, visited)) {
+                return true;
+            }
+        }
         return false;
     }
 
-    Prover std_prover(WSLINK wstp_link) {
+    bool _contains_fresh_var(TermRef<int> term, const Signature<int>& sig) {
+        std::unordered_set<const Term<int>*> visited;
+        return _contains_fresh_var(term, sig, visited);
+    }
+
+    TermPtr<int> Prover::transfer_from_worker(TermPtr<int> term) {
+        auto& worker_sig = worker_kernel->get_sig();
+        if (worker_sig.get_symbol_num() == worker_symbol_num) {
+            return term;
+        }
+        return _rename_symbols(term, worker_symbol_num, worker_sig, kernel.get_sig());
+    }
+
+    std::pair<TermPtr<int>, TermPtr<int>> Prover::normalize_pair(TermPtr<int> termA, TermPtr<int> termB, bool distribute, bool concurrent) {
+        auto trace = get_trace_sink();
+
+        if (!concurrent) {
+            auto final_termA = normalize(kernel, termA, trace, distribute, rewrite_strategy);
+            auto final_termB = normalize(kernel, termB, trace, distribute, rewrite_strategy);
+            return {final_termA, final_termB};
+        }
+
+        // the steps and the rule profiles of the second term are recorded separately, and merged afterwards
+        CountSink countsB;
+        auto& profiler = get_rule_profiler();
+        RuleProfiler profilerB;
+        auto future_B = std::async(std::launch::async, [&]() {
+            // the profiler of the worker thread is used only for this term
+            auto& local_profiler = get_rule_profiler();
+            local_profiler.reset();
+            local_profiler.set_enabled(profiler.is_enabled());
+            auto res = normalize(*worker_kernel, termB, trace != nullptr ? &countsB : nullptr, distribute, rewrite_strategy);
+            profilerB = local_profiler;
+            return res;
+        });
+        auto final_termA = normalize(kernel, termA, trace, distribute, rewrite_strategy);
+        auto final_termB = future_B.get();
+        trace_counts.merge(countsB);
+        profiler.merge(profilerB);
+
+        // the fresh variables of the two sides are not distinguished, see sync_worker_kernel
+        if (_contains_fresh_var(*final_termA, kernel.get_sig()) || _contains_fresh_var(*final_termB, worker_kernel->get_sig())) {
+            throw std::logic_error("A fresh variable remains in the normal form of the concurrent check_eq.");
+        }
+
+        return {final_termA, transfer_from_worker(final_termB)};
+    }
+
+    TraceSink* Prover::get_trace_sink() {
+        switch (trace_level) {
+            case TraceLevel::COUNTS:
+                return &trace_counts;
+            case TraceLevel::FULL:
+                return trace_log.get();
+            default:
+                return nullptr;
+        }
+    }
+
+    void Prover::set_trace_level(TraceLevel level, const std::string& log_path) {
+        // close the previous log
+        trace_log.reset();
+        trace_log_file.reset();
+
+        if (level == TraceLevel::FULL) {
+            auto file = std::make_unique<std::ofstream>(log_path, std::ios::binary);
+            if (!file->is_open()) {
+                throw std::runtime_error("Cannot open the trace log '" + log_path + "'.");
+            }
+            trace_log_file = std::move(file);
+            trace_log = std::make_unique<TraceLogWriter>(*trace_log_file, kernel.get_sig());
+        }
+        trace_level = level;
+    }
+
+    Prover std_prover(WSLINK wstp_link, std::ostream& output) {
 
-        auto res = Prover{wstp_link, std::cout};
+        auto res = Prover{wstp_link, output};
 
         res.process(R"(
         (* Trace
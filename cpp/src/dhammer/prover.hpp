@@ -4,6 +4,9 @@
 
 #include <iostream>
 #include <fstream>
+#include <future>
+#include <memory>
+#include <optional>
 
 #include "calculus.hpp"
 #include "trace.hpp"
@@ -15,8 +18,35 @@ namespace dhammer {
         Kernel kernel;
         std::ostream& output;
 
+        // Whether check_eq normalizes the two sides concurrently.
+        bool concurrent_check_eq = false;
+
+        // The kernel normalizing the second side of check_eq in the concurrent mode. It is copied from `kernel` only when
+        // env changes, and keeps its caches between the commands otherwise.
+        std::optional<Kernel> worker_kernel;
+        // The env version and the number of symbols of `kernel` when the worker kernel was synchronized.
+        std::size_t worker_env_version = 0;
+        std::size_t worker_symbol_num = 0;
+
+        // The rewriting strategy used to normalize the terms.
+        RewriteStrategy rewrite_strategy = RewriteStrategy::LEFTMOST_OUTERMOST;
+
+        // The options to print the normalized terms and the traces.
+        ualg::PrintOptions print_options;
+
+        // The trace of Normalize (without the trace output) and CheckEq.
+        TraceLevel trace_level = TraceLevel::OFF;
+        CountSink trace_counts;
+        std::unique_ptr<std::ofstream> trace_log_file;
+        std::unique_ptr<TraceLogWriter> trace_log;
+
 
     protected:
+        /**
+         * @brief Return the sink of the trace level, or nullptr if the trace is off.
+         */
+        TraceSink* get_trace_sink();
+
         bool check_id(const astparser::AST& ast) {
             if (ast.children.size() != 0) {
                 output << "Error: the identifier is not valid." << std::endl;
@@ -31,8 +61,9 @@ namespace dhammer {
         
         Prover(WSLINK wstp_link = nullptr, std::ostream& _output = std::cout) : kernel(wstp_link), output(_output) {}
 
-        // copy constructor (coq_file is not copied)
-        Prover(const Prover& other) : kernel(other.kernel), output(other.output) {}
+        // copy constructor (coq_file and the trace are not copied)
+        Prover(const Prover& other) : kernel(other.kernel), output(other.output), concurrent_check_eq(other.concurrent_check_eq),
+            rewrite_strategy(other.rewrite_strategy), print_options(other.print_options) {}
 
 
         ~Prover() {}
@@ -50,6 +81,47 @@ namespace dhammer {
 
         bool process(const astparser::AST& ast);
 
+        /**
+         * @brief Set whether check_eq normalizes the two sides concurrently. The second side is normalized by a worker copy of the kernel in another thread.
+         * It has no effect if the terms are not reference counted atomically.
+         */
+        inline void set_concurrent_check_eq(bool enabled) {
+            concurrent_check_eq = enabled && ualg::Term<int>::RefCount::thread_safe;
+        }
+
+        /**
+         * @brief Set the rewriting strategy used by Normalize and CheckEq. The default is leftmost-outermost.
+         */
+        inline void set_rewrite_strategy(RewriteStrategy strategy) {
+            rewrite_strategy = strategy;
+        }
+
+        /**
+         * @brief Set the options to print the normalized terms and the traces, e.g., to abbreviate the shared subterms or
+         * to elide the deep subterms of huge normal forms. The default options print the whole terms.
+         */
+        inline void set_print_options(const ualg::PrintOptions& options) {
+            print_options = options;
+        }
+
+        /**
+         * @brief Set the trace level of Normalize (without the trace output) and CheckEq. The FULL level streams the
+         * steps to the binary trace log at `log_path`, which can be replayed by the dhammer_trace tool, and then CheckEq
+         * normalizes the two sides sequentially. The trace is off by default.
+         */
+        void set_trace_level(TraceLevel level, const std::string& log_path = "");
+
+        inline TraceLevel get_trace_level() const {
+            return trace_level;
+        }
+
+        /**
+         * @brief Return the step counts of the COUNTS level.
+         */
+        inline CountSink& get_trace_counts() {
+            return trace_counts;
+        }
+
         inline bool check_eq(const std::string& codeA, const std::string& codeB) {
             auto astA = parse(codeA);
             auto astB = parse(codeB);
@@ -71,13 +143,37 @@ namespace dhammer {
          * @return false 
          */
         bool check_eq(const astparser::AST& codeA, const astparser::AST& codeB);
+
+    protected:
+        /**
+         * @brief Bring the worker kernel up to date with `kernel`. It is copied again only if env has changed, or if the
+         * worker has registered symbols of its own. Otherwise it only registers the new symbols of `kernel` with the same
+         * ids, and continues from the fresh variables of `kernel`.
+         */
+        Kernel& sync_worker_kernel();
+
+        /**
+         * @brief Move the term from the worker kernel to `kernel`. The terms are shared by the kernels, so only the
+         * symbols registered by the worker since the synchronization are renamed, which is usually none.
+         */
+        ualg::TermPtr<int> transfer_from_worker(ualg::TermPtr<int> term);
+
+        /**
+         * @brief Normalize the two terms, concurrently by the worker kernel for the second term if `concurrent` is set.
+         * The worker kernel should be synchronized before.
+         * 
+         * @return std::pair<ualg::TermPtr<int>, ualg::TermPtr<int>> The normalized terms, both in the signature of `kernel`.
+         */
+        std::pair<ualg::TermPtr<int>, ualg::TermPtr<int>> normalize_pair(ualg::TermPtr<int> termA, ualg::TermPtr<int> termB, bool distribute, bool concurrent);
     };
 
     /**
      * @brief Return the prover with standard definitions.
      * 
+     * @param wstp_link 
+     * @param output The output stream of the prover.
      * @return Prover 
      */
-    Prover std_prover(WSLINK wstp_link = nullptr);
+    Prover std_prover(WSLINK wstp_link = nullptr, std::ostream& output = std::cout);
 
 } // namespace dhammer
\ No newline at end of file
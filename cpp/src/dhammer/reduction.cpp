@@ -6,130 +6,882 @@ namespace dhammer {
     using namespace std;
 
 
+    const RulePattern& get_rule_pattern(PosRewritingRule rule) {
+        // R_DELTA and R_FLATTEN can match any head.
+        static const std::map<PosRewritingRule, RulePattern> rule_patterns = {
+            {R_COMPO_SS, {{COMPO}}},
+            {R_COMPO_SK, {{COMPO}}},
+            {R_COMPO_SB, {{COMPO}}},
+            {R_COMPO_SO, {{COMPO}}},
+            {R_COMPO_KS, {{COMPO}}},
+            {R_COMPO_KK, {{COMPO}}},
+            {R_COMPO_KB, {{COMPO}}},
+            {R_COMPO_BS, {{COMPO}}},
+            {R_COMPO_BK, {{COMPO}}},
+            {R_COMPO_BB, {{COMPO}}},
+            {R_COMPO_BO, {{COMPO}}},
+            {R_COMPO_OS, {{COMPO}}},
+            {R_COMPO_OK, {{COMPO}}},
+            {R_COMPO_OO, {{COMPO}}},
+            {R_COMPO_DD, {{COMPO}}},
+            {R_COMPO_ARROW, {{COMPO}}},
+            {R_COMPO_FORALL, {{COMPO}}},
+            {R_STAR_PROD, {{STAR}}},
+            {R_STAR_MULS, {{STAR}}},
+            {R_STAR_TSRO, {{STAR}}},
+            {R_STAR_CATPROD, {{STAR}}},
+            {R_STAR_LTSR, {{STAR}}},
+            {R_ADDG_ADDS, {{ADDG}}},
+            {R_ADDG_ADD, {{ADDG}}},
+            {R_SSUM, {{SSUM}}},
+            {R_BETA_ARROW, {{APPLY}, {FUN}}},
+            {R_BETA_INDEX, {{APPLY}, {IDX}}},
+            {R_DELTA, {{}}},
+            {R_FLATTEN, {{}}},
+            {R_ADDSID, {{ADDS}}},
+            {R_MULSID, {{MULS}}},
+            {R_ADDS0, {{ADDS}}},
+            {R_MULS0, {{MULS}}},
+            {R_MULS1, {{MULS}}},
+            {R_MULS2, {{MULS}}},
+            {R_CONJ0, {{CONJ}}},
+            {R_CONJ1, {{CONJ}}},
+            {R_CONJ2, {{CONJ}, {ADDS}}},
+            {R_CONJ3, {{CONJ}, {MULS}}},
+            {R_CONJ4, {{CONJ}, {CONJ}}},
+            {R_CONJ5, {{CONJ}}},
+            {R_CONJ6, {{CONJ}, {DOT}}},
+            {R_DOT0, {{DOT}}},
+            {R_DOT1, {{DOT}}},
+            {R_DOT2, {{DOT}, {SCR}}},
+            {R_DOT3, {{DOT}, {ANY_HEAD, SCR}}},
+            {R_DOT4, {{DOT}, {ADD}}},
+            {R_DOT5, {{DOT}, {ANY_HEAD, ADD}}},
+            {R_DOT6, {{DOT}, {BRA, KET}}},
+            {R_DOT7, {{DOT}, {TSR, KET}}},
+            {R_DOT8, {{DOT}, {BRA}}},
+            {R_DOT9, {{DOT}, {TSR, TSR}}},
+            {R_DOT10, {{DOT}, {MULB}}},
+            {R_DOT11, {{DOT}, {BRA}}},
+            {R_DOT12, {{DOT}, {TSR, MULK}}},
+            {R_DELTA0, {{DELTA}}},
+            {R_DELTA1, {{DELTA}, {PAIR, PAIR}}},
+            {R_SCR0, {{SCR}}},
+            {R_SCR1, {{SCR}, {ANY_HEAD, SCR}}},
+            {R_SCR2, {{SCR}, {ANY_HEAD, ADD}}},
+            {R_SCRK0, {{SCR}}},
+            {R_SCRK1, {{SCR}}},
+            {R_SCRB0, {{SCR}}},
+            {R_SCRB1, {{SCR}}},
+            {R_SCRO0, {{SCR}}},
+            {R_SCRO1, {{SCR}}},
+            {R_ADDID, {{ADD}}},
+            {R_ADD0, {{ADD}}},
+            {R_ADD1, {{ADD}}},
+            {R_ADD2, {{ADD}}},
+            {R_ADD3, {{ADD}}},
+            {R_ADD_MERGE, {{ADD}}},
+            {R_ADDK0, {{ADD}}},
+            {R_ADDB0, {{ADD}}},
+            {R_ADDO0, {{ADD}}},
+            {R_ADJ0, {{ADJ}, {ADJ}}},
+            {R_ADJ1, {{ADJ}, {SCR}}},
+            {R_ADJ2, {{ADJ}, {ADD}}},
+            {R_ADJ3, {{ADJ}, {TSR}}},
+            {R_ADJK0, {{ADJ}, {ZEROB}}},
+            {R_ADJK1, {{ADJ}, {BRA}}},
+            {R_ADJK2, {{ADJ}, {MULB}}},
+            {R_ADJB0, {{ADJ}, {ZEROK}}},
+            {R_ADJB1, {{ADJ}, {KET}}},
+            {R_ADJB2, {{ADJ}, {MULK}}},
+            {R_ADJO0, {{ADJ}, {ZEROO}}},
+            {R_ADJO1, {{ADJ}}},
+            {R_ADJO2, {{ADJ}, {OUTER}}},
+            {R_ADJO3, {{ADJ}, {MULO}}},
+            {R_TSR0, {{TSR}, {SCR}}},
+            {R_TSR1, {{TSR}, {ANY_HEAD, SCR}}},
+            {R_TSR2, {{TSR}, {ADD}}},
+            {R_TSR3, {{TSR}, {ANY_HEAD, ADD}}},
+            {R_TSRK0, {{TSR}, {ZEROK}}},
+            {R_TSRK1, {{TSR}, {ANY_HEAD, ZEROK}}},
+            {R_TSRK2, {{TSR}, {KET, KET}}},
+            {R_TSRB0, {{TSR}, {ZEROB}}},
+            {R_TSRB1, {{TSR}, {ANY_HEAD, ZEROB}}},
+            {R_TSRB2, {{TSR}, {BRA, BRA}}},
+            {R_TSRO0, {{TSR}, {ZEROO}}},
+            {R_TSRO1, {{TSR}, {ANY_HEAD, ZEROO}}},
+            {R_TSRO2, {{TSR}, {ONEO, ONEO}}},
+            {R_TSRO3, {{TSR}, {OUTER, OUTER}}},
+            {R_MULK0, {{MULK}, {ZEROO}}},
+            {R_MULK1, {{MULK}}},
+            {R_MULK2, {{MULK}}},
+            {R_MULK3, {{MULK}, {SCR}}},
+            {R_MULK4, {{MULK}, {ANY_HEAD, SCR}}},
+            {R_MULK5, {{MULK}, {ADD}}},
+            {R_MULK6, {{MULK}, {ANY_HEAD, ADD}}},
+            {R_MULK7, {{MULK}, {OUTER}}},
+            {R_MULK8, {{MULK}, {MULO}}},
+            {R_MULK9, {{MULK}, {TSR, MULK}}},
+            {R_MULK10, {{MULK}, {TSR, KET}}},
+            {R_MULK11, {{MULK}, {TSR, TSR}}},
+            {R_MULB0, {{MULB}, {ANY_HEAD, ZEROO}}},
+            {R_MULB1, {{MULB}}},
+            {R_MULB2, {{MULB}}},
+            {R_MULB3, {{MULB}, {SCR}}},
+            {R_MULB4, {{MULB}, {ANY_HEAD, SCR}}},
+            {R_MULB5, {{MULB}, {ADD}}},
+            {R_MULB6, {{MULB}, {ANY_HEAD, ADD}}},
+            {R_MULB7, {{MULB}, {ANY_HEAD, OUTER}}},
+            {R_MULB8, {{MULB}, {ANY_HEAD, MULO}}},
+            {R_MULB9, {{MULB}, {MULB}}},
+            {R_MULB10, {{MULB}, {BRA}}},
+            {R_MULB11, {{MULB}, {TSR, TSR}}},
+            {R_OUTER0, {{OUTER}, {ZEROK}}},
+            {R_OUTER1, {{OUTER}, {ANY_HEAD, ZEROB}}},
+            {R_OUTER2, {{OUTER}, {SCR}}},
+            {R_OUTER3, {{OUTER}, {ANY_HEAD, SCR}}},
+            {R_OUTER4, {{OUTER}, {ADD}}},
+            {R_OUTER5, {{OUTER}, {ANY_HEAD, ADD}}},
+            {R_MULO0, {{MULO}, {ZEROO}}},
+            {R_MULO1, {{MULO}, {ANY_HEAD, ZEROO}}},
+            {R_MULO2, {{MULO}}},
+            {R_MULO3, {{MULO}}},
+            {R_MULO4, {{MULO}, {OUTER}}},
+            {R_MULO5, {{MULO}, {ANY_HEAD, OUTER}}},
+            {R_MULO6, {{MULO}, {SCR}}},
+            {R_MULO7, {{MULO}, {ANY_HEAD, SCR}}},
+            {R_MULO8, {{MULO}, {ADD}}},
+            {R_MULO9, {{MULO}, {ANY_HEAD, ADD}}},
+            {R_MULO10, {{MULO}, {MULO}}},
+            {R_MULO11, {{MULO}, {TSR, TSR}}},
+            {R_MULO12, {{MULO}, {TSR, MULO}}},
+            {R_SET0, {{CATPROD}, {USET, USET}}},
+            {R_SUM_CONST0, {{SUM}, {ANY_HEAD, FUN}}},
+            {R_SUM_CONST1, {{SUM}, {ANY_HEAD, FUN}}},
+            {R_SUM_CONST2, {{SUM}, {ANY_HEAD, FUN}}},
+            {R_SUM_CONST3, {{SUM}, {ANY_HEAD, FUN}}},
+            {R_SUM_CONST4, {{ONEO}}},
+            {R_SUM_ELIM0, {{SUM}, {USET, FUN}}},
+            {R_SUM_ELIM1, {{SUM}, {USET, FUN}}},
+            {R_SUM_ELIM2, {{SUM}, {USET, FUN}}},
+            {R_SUM_ELIM3, {{SUM}, {USET, FUN}}},
+            {R_SUM_ELIM4, {{SUM}, {ANY_HEAD, FUN}}},
+            {R_SUM_ELIM5, {{SUM}, {ANY_HEAD, FUN}}},
+            {R_SUM_ELIM6, {{SUM}, {ANY_HEAD, FUN}}},
+            {R_SUM_ELIM7, {{SUM}, {ANY_HEAD, FUN}}},
+            {R_SUM_PUSH0, {{MULS}}},
+            {R_SUM_PUSH1, {{CONJ}, {SUM}}},
+            {R_SUM_PUSH2, {{ADJ}, {SUM}}},
+            {R_SUM_PUSH3, {{SCR}, {ANY_HEAD, SUM}}},
+            {R_SUM_PUSH4, {{SCR}, {SUM}}},
+            {R_SUM_PUSH5, {{DOT}, {SUM}}},
+            {R_SUM_PUSH6, {{MULK}, {SUM}}},
+            {R_SUM_PUSH7, {{MULB}, {SUM}}},
+            {R_SUM_PUSH8, {{OUTER}, {SUM}}},
+            {R_SUM_PUSH9, {{MULO}, {SUM}}},
+            {R_SUM_PUSH10, {{DOT}, {ANY_HEAD, SUM}}},
+            {R_SUM_PUSH11, {{MULK}, {ANY_HEAD, SUM}}},
+            {R_SUM_PUSH12, {{MULB}, {ANY_HEAD, SUM}}},
+            {R_SUM_PUSH13, {{OUTER}, {ANY_HEAD, SUM}}},
+            {R_SUM_PUSH14, {{MULO}, {ANY_HEAD, SUM}}},
+            {R_SUM_PUSH15, {{TSR}, {SUM}}},
+            {R_SUM_PUSH16, {{TSR}, {ANY_HEAD, SUM}}},
+            {R_SUM_ADDS0, {{SUM}, {ANY_HEAD, FUN}}},
+            {R_SUM_ADDS1, {{SUM}, {ANY_HEAD, FUN}}},
+            {R_SUM_ADD0, {{SUM}, {ANY_HEAD, FUN}}},
+            {R_SUM_ADD1, {{SUM}, {ANY_HEAD, FUN}}},
+            {R_SUM_INDEX0, {{SUM}, {USET}}},
+            {R_SUM_INDEX1, {{SUM}, {CATPROD, FUN}}},
+            {R_SUM_FACTOR, {{ADD, ADDS}}},
+            {R_BIT_DELTA, {{DELTA}}},
+            {R_BIT_ONEO, {{ONEO}}},
+            {R_BIT_SUM, {{SUM}, {USET}}},
+            {R_OPT_SUBS, {{SUBS}}},
+            {R_DTYPE_SCALAR, {{DTYPE}}},
+            {R_ADD_REDUCE, {{ADD}}},
+            {R_SCR_REDUCE, {{SCR}}},
+            {R_ADJ_REDUCE, {{ADJ}}},
+            {R_LDOT_REDUCE, {{LDOT}}},
+            {R_LTSR_REDUCE, {{LTSR}}},
+            {R_LABEL_EXPAND, {{SUBS}}},
+            {R_ADJDK, {{ADJ}, {LBRA}}},
+            {R_ADJDB, {{ADJ}, {LKET}}},
+            {R_ADJD0, {{ADJ}, {LTSR}}},
+            {R_ADJD1, {{ADJ}, {LDOT}}},
+            {R_SCRD0, {{LTSR}}},
+            {R_SCRD1, {{LDOT}, {SCR}}},
+            {R_SCRD2, {{LDOT}, {ANY_HEAD, SCR}}},
+            {R_SCRD3, {{SCR}, {ZERO}}},
+            {R_SCRD4, {{SCR}}},
+            {R_ADDD0, {{ADD}}},
+            {R_TSRD0, {{LTSR}}},
+            {R_TSRD1, {{LTSR}}},
+            {R_DOTD0, {{LDOT}, {ADD}}},
+            {R_DOTD1, {{LDOT}, {ANY_HEAD, ADD}}},
+            {R_SUM_PUSHD0, {{LTSR}}},
+            {R_SUM_PUSHD1, {{LDOT}, {SUM}}},
+            {R_SUM_PUSHD2, {{LDOT}, {ANY_HEAD, SUM}}},
+            {R_L_SORT0, {{LDOT}}},
+            {R_L_SORT1, {{LDOT}, {LBRA, LKET}}},
+            {R_L_SORT2, {{LDOT}, {LBRA, LTSR}}},
+            {R_L_SORT3, {{LDOT}, {LTSR, LKET}}},
+            {R_L_SORT4, {{LDOT}, {LTSR, LTSR}}},
+
+
+        };
+
+        static const RulePattern any_pattern;
+
+        auto find_res = rule_patterns.find(rule);
+        if (find_res == rule_patterns.end()) {
+            return any_pattern;
+        }
+        return find_res->second;
+    }
+
+    RuleSet::RuleSet(std::initializer_list<PosRewritingRule> rules) : rules(rules) {}
+
+    RuleSet::RuleSet(const std::vector<PosRewritingRule>& rules) : rules(rules) {}
+
+    RuleSet::RuleSet(const RuleSet& other) : rules(other.rules) {}
+
+    void RuleSet::insert_pattern(int rule_id, const RulePattern& pattern) const {
+        // the keys below the root: the argument heads, truncated to the depth of the index
+        auto key_num = std::min(pattern.arg_heads.size(), max_index_depth - 1);
+
+        auto insert_from = [&](int node) {
+            for (std::size_t i = 0; i < key_num; i++) {
+                auto head = pattern.arg_heads[i];
+                int child;
+                if (head == ANY_HEAD) {
+                    child = index[node].any_child;
+                    if (child == -1) {
+                        child = index.size();
+                        index[node].any_child = child;
+                        index.emplace_back();
+                    }
+                }
+                else {
+                    auto& children = index[node].children;
+                    auto it = std::lower_bound(children.begin(), children.end(), std::make_pair(head, -1));
+                    if (it != children.end() && it->first == head) {
+                        child = it->second;
+                    }
+                    else {
+                        child = index.size();
+                        children.insert(it, {head, child});
+                        index.emplace_back();
+                    }
+                }
+                node = child;
+            }
+            index[node].rules.push_back(rule_id);
+        };
+
+        if (pattern.heads.size() == 0) {
+            if (index[0].any_child == -1) {
+                index[0].any_child = index.size();
+                index.emplace_back();
+            }
+            insert_from(index[0].any_child);
+            return;
+        }
+        for (auto head : pattern.heads) {
+            if (root_children[head] == -1) {
+                root_children[head] = index.size();
+                index.emplace_back();
+            }
+            insert_from(root_children[head]);
+        }
+    }
+
+    void RuleSet::compile() const {
+        int table_size = 0;
+        for (const auto& rule : rules) {
+            for (auto head : get_rule_heads(rule)) {
+                table_size = std::max(table_size, head + 1);
+            }
+        }
+
+        index.assign(1, {});
+        root_children.assign(table_size, -1);
+        for (int i = 0; i < rules.size(); i++) {
+            insert_pattern(i, get_rule_pattern(rules[i]));
+        }
+    }
+
+    const std::vector<PosRewritingRule>& RuleSet::get_rules() const {
+        return rules;
+    }
+
+    RuleSet::Candidates RuleSet::get_candidates(TermRef<int> term) const {
+        std::call_once(compile_flag, &RuleSet::compile, this);
+
+        Candidates res;
+        res.rules = &rules;
+
+        // the nodes reached on the current level, and the keys of the term on the levels
+        std::array<int, 1 << max_index_depth> level, next_level;
+        std::size_t level_num = 0, next_num;
+
+        auto head = term.get_head();
+        if (head >= 0 && head < root_children.size() && root_children[head] != -1) {
+            level[level_num++] = root_children[head];
+        }
+        if (index[0].any_child != -1) {
+            level[level_num++] = index[0].any_child;
+        }
+
+        auto& args = term.get_args();
+        for (std::size_t depth = 0; level_num > 0; depth++) {
+            next_num = 0;
+            for (std::size_t i = 0; i < level_num; i++) {
+                auto& node = index[level[i]];
+                if (!node.rules.empty()) {
+                    res.lists[res.list_num++] = node.rules;
+                }
+                if (depth >= args.size()) {
+                    continue;
+                }
+
+                auto arg_head = args[depth]->get_head();
+                auto it = std::lower_bound(node.children.begin(), node.children.end(), std::make_pair(arg_head, -1));
+                if (it != node.children.end() && it->first == arg_head) {
+                    next_level[next_num++] = it->second;
+                }
+                if (node.any_child != -1) {
+                    next_level[next_num++] = node.any_child;
+                }
+            }
+            level = next_level;
+            level_num = next_num;
+        }
+        return res;
+    }
+
+    PosRewritingRule RuleSet::Candidates::next() {
+        // take the smallest rule index at the fronts of the lists
+        std::size_t min_list = list_num;
+        for (std::size_t i = 0; i < list_num; i++) {
+            if (!lists[i].empty() && (min_list == list_num || lists[i].front() < lists[min_list].front())) {
+                min_list = i;
+            }
+        }
+        if (min_list == list_num) {
+            return nullptr;
+        }
+
+        auto rule_id = lists[min_list].front();
+        lists[min_list] = lists[min_list].subspan(1);
+        return (*rules)[rule_id];
+    }
+
+    bool IrreducibleMemo::is_irreducible(const Kernel& kernel, TermPtr<int> term) const {
+        return irreducible_terms.find(TermContextKey{term, kernel.get_context_id()}) != irreducible_terms.end();
+    }
+
+    void IrreducibleMemo::set_irreducible(const Kernel& kernel, TermPtr<int> term) {
+        irreducible_terms.insert(TermContextKey{term, kernel.get_context_id()});
+    }
+
+    // The rule applied to a term, and the replacement.
+    using _RuleApplication = std::pair<PosRewritingRule, TermPtr<int>>;
+
     /**
-     * @brief The main function to process the recursive matching. Note that the context will be changed when entering bound variable scopes.
-     * 
-     * @param kernel 
-     * @param term 
-     * @param rules 
-     * @param current_pos 
-     * @return std::optional<PosReplaceRecord> 
+     * @brief Report a rewriting step to the sink, which should not be nullptr. The record is built by `make_record`
+     * only if the sink wants it.
      */
-    std::optional<PosReplaceRecord> get_pos_replace(Kernel& kernel, TermPtr<int> term, const std::vector<PosRewritingRule>& rules, TermPos& current_pos) {
-        auto head = term->get_head();
-        auto args = term->get_args();
+    template <class MakeRecord>
+    inline void _trace_step(TraceSink* trace, std::string_view step, MakeRecord&& make_record) {
+        if (trace->wants_records()) {
+            trace->record(make_record());
+        }
+        else {
+            trace->count(step);
+        }
+    }
 
-        // Check whether the rule can be applied to this term
-        for (const auto& rule : rules) {
+    /**
+     * @brief Try the rules on the term itself (not on its subterms), in the order of the rule set.
+     *
+     * @return std::optional<_RuleApplication> The first rule that applies, and the replacement.
+     */
+    std::optional<_RuleApplication> _apply_rules(Kernel& kernel, const TermPtr<int>& term, const RuleSet& rules) {
+#if DHAMMER_RULE_PROFILING
+        auto& profiler = get_rule_profiler();
+#endif
+
+#if DHAMMER_RULE_INDEX
+        auto candidates = rules.get_candidates(*term);
+        while (auto rule = candidates.next()) {
+#else
+        for (auto rule : rules.get_rules()) {
+#endif
+#if DHAMMER_RULE_PROFILING
+            std::optional<TermPtr<int>> apply_res;
+            if (profiler.is_enabled()) {
+                auto start = std::chrono::steady_clock::now();
+                apply_res = rule(kernel, term);
+                profiler.record(rule, apply_res.has_value(), std::chrono::steady_clock::now() - start);
+            }
+            else {
+                apply_res = rule(kernel, term);
+            }
+#else
             auto apply_res = rule(kernel, term);
+#endif
             if (apply_res.has_value()) {
-                // return the discovered replacement
-                return PosReplaceRecord{
-                    rule_name.at(rule), // rule name
-                    current_pos,    // position
-                    nullptr,           // initial term
-                    term,           // matched term
-                    apply_res.value(), // replacement
-                    nullptr,        // final term
-                };
+                return std::make_pair(rule, apply_res.value());
             }
         }
-        
-        // Check whether the rule can be applied to the subterms
-        if (head == FUN) {
+        return std::nullopt;
+    }
 
-            // check whether the type can be rewritten
-            current_pos.push_back(1);
-            auto replace_res = get_pos_replace(kernel, args[1], rules, current_pos);
-            current_pos.pop_back();
-            if (replace_res.has_value()) {
-                return replace_res;
-            }
+    /**
+     * @brief Try the rules on the term, for the strategies that can rewrite the arguments before the term. The argument
+     * of a beta redex may then contain binders, which the substitution can copy into the scope of each other, so the
+     * bound variables of the result are renamed apart.
+     */
+    std::optional<_RuleApplication> _apply_rules_renaming(Kernel& kernel, const TermPtr<int>& term, const RuleSet& rules) {
+        auto apply_res = _apply_rules(kernel, term, rules);
+        if (apply_res.has_value() && (apply_res->first == R_BETA_ARROW || apply_res->first == R_BETA_INDEX)) {
+            apply_res->second = bound_variable_rename(kernel, apply_res->second);
+        }
+        return apply_res;
+    }
+
+    /**
+     * @brief Whether the argument i is searched for redexes. The bound variables of FUN and IDX are not searched.
+     */
+    inline bool _is_searched_arg(int head, unsigned int i) {
+        return !((head == FUN || head == IDX) && i == 0);
+    }
 
-            // check whether the body can be rewritten (with context push)
+    /**
+     * @brief Push the context before entering the argument i, if it is in the scope of a bound variable.
+     *
+     * @param args The current arguments of the term.
+     * @return bool Whether the context is pushed, in which case it should be popped when leaving the argument.
+     */
+    bool _enter_arg(Kernel& kernel, int head, std::span<const TermPtr<int>> args, unsigned int i) {
+        if (head == FUN && i == 2) {
             kernel.context_push(args[0]->get_head(), args[1]);
-            current_pos.push_back(2);
-            replace_res = get_pos_replace(kernel, args[2], rules, current_pos);
-            current_pos.pop_back();
-            kernel.context_pop();
+            return true;
+        }
+        if (head == IDX && i == 1) {
+            kernel.context_push(args[0]->get_head(), create_term(INDEX));
+            return true;
+        }
+        return false;
+    }
 
-            if (replace_res.has_value()) {
-                return replace_res;
-            }
+    std::optional<_RuleApplication> get_pos_replace(Kernel& kernel, TermCursor<int>& cursor, const RuleSet& rules, IrreducibleMemo* memo);
 
-            return std::nullopt;
+    /**
+     * @brief Search the argument i of the subterm under the cursor. The context is pushed when entering the scope of a
+     * bound variable, and popped when leaving it, so that it stays aligned with the cursor.
+     *
+     * @return std::optional<_RuleApplication> The rule application if a rule applies inside the argument, in which case
+     * the cursor is left at the matched subterm.
+     */
+    std::optional<_RuleApplication> _get_pos_replace_arg(Kernel& kernel, TermCursor<int>& cursor, unsigned int i, const RuleSet& rules, IrreducibleMemo* memo) {
+        auto& term = cursor.get_focus();
+        bool pushed = _enter_arg(kernel, term->get_head(), term->get_args(), i);
+
+        cursor.down(i);
+        auto replace_res = get_pos_replace(kernel, cursor, rules, memo);
+        if (!replace_res.has_value()) {
+            cursor.up();
         }
-        else if (head == IDX) {
-            kernel.context_push(args[0]->get_head(), create_term(INDEX));
-            
-            current_pos.push_back(1);
-            auto replace_res = get_pos_replace(kernel, args[1], rules, current_pos);
-            current_pos.pop_back();
 
+        if (pushed) {
             kernel.context_pop();
+        }
+        return replace_res;
+    }
+
+    /**
+     * @brief The main function to process the recursive matching. Note that the context will be changed when entering bound variable scopes.
+     * 
+     * @param kernel 
+     * @param cursor The cursor pointing to the term to search.
+     * @param rules 
+     * @param memo The record of irreducible subterms. It is not used if nullptr.
+     * @return std::optional<_RuleApplication> The rule application, with the cursor left at the matched subterm.
+     */
+    std::optional<_RuleApplication> _get_pos_replace(Kernel& kernel, TermCursor<int>& cursor, const RuleSet& rules, IrreducibleMemo* memo) {
+        auto& term = cursor.get_focus();
+        auto head = term->get_head();
+        auto& args = term->get_args();
 
+        // Check whether the rule can be applied to this term
+        auto apply_res = _apply_rules(kernel, term, rules);
+        if (apply_res.has_value()) {
+            // return the discovered replacement
+            return apply_res;
+        }
+        
+        // Check whether the rule can be applied to the subterms (with context push for the bound variables)
+        for (unsigned int i = 0; i < args.size(); i++) {
+            if (!_is_searched_arg(head, i)) {
+                continue;
+            }
+            auto replace_res = _get_pos_replace_arg(kernel, cursor, i, rules, memo);
             if (replace_res.has_value()) {
                 return replace_res;
             }
-            return std::nullopt;
         }
-        else {
-            for (unsigned int i = 0; i < args.size(); i++) {
-                current_pos.push_back(i);
-                auto replace_res = get_pos_replace(kernel, args[i], rules, current_pos);
-                if (replace_res.has_value()) {
-                    return replace_res;
-                }
-                current_pos.pop_back();
-            }
+        return std::nullopt;
+    }
 
-            return std::nullopt;        
+    std::optional<_RuleApplication> get_pos_replace(Kernel& kernel, TermCursor<int>& cursor, const RuleSet& rules, IrreducibleMemo* memo) {
+        if (memo == nullptr) {
+            return _get_pos_replace(kernel, cursor, rules, nullptr);
         }
-    }
 
-    std::optional<PosReplaceRecord> get_pos_replace(Kernel& kernel, TermPtr<int> term, const std::vector<PosRewritingRule>& rules) {
-        TermPos current_pos;
-        auto res = get_pos_replace(kernel, term, rules, current_pos);
+        // skip the subterms that are already known to be irreducible
+        auto& term = cursor.get_focus();
+        if (memo->is_irreducible(kernel, term)) {
+            return std::nullopt;
+        }
 
-        // record the whole term in the trace
-        if (res.has_value()) {
-            res->init_term = term;
-            return res;
+        auto res = _get_pos_replace(kernel, cursor, rules, memo);
+        if (!res.has_value()) {
+            memo->set_irreducible(kernel, term);
         }
-        else{
+        return res;
+    }
+
+    std::optional<PosReplaceRecord> get_pos_replace(Kernel& kernel, TermPtr<int> term, const RuleSet& rules) {
+        TermCursor<int> cursor(term);
+        auto apply_res = get_pos_replace(kernel, cursor, rules, nullptr);
+        if (!apply_res.has_value()) {
             return std::nullopt;
         }
+        return PosReplaceRecord{
+            rule_name.at(apply_res->first), // rule name
+            cursor.get_pos(),    // position
+            cursor.get_root(),  // initial term
+            cursor.get_focus(), // matched term
+            apply_res->second, // replacement
+            nullptr,        // final term
+        };
     }
 
-    TermPtr<int> pos_rewrite_repeated(Kernel& kernel, TermPtr<int> term, const std::vector<PosRewritingRule>& rules, std::vector<PosReplaceRecord>* trace) {
+    /**
+     * @brief The leftmost-outermost rewriting: rewrite the first redex found from the root, and search again.
+     */
+    TermPtr<int> _rewrite_leftmost_outermost(Kernel& kernel, TermPtr<int> term, const RuleSet& rules, TraceSink* trace) {
         auto current_term = term;
+
+        // the subterms unchanged by a rewriting step are not searched again
+        IrreducibleMemo memo;
+
         while (true) {
-            auto replace_res = get_pos_replace(kernel, current_term, rules);
+            TermCursor<int> cursor(current_term);
+            auto replace_res = get_pos_replace(kernel, cursor, rules, &memo);
             if (replace_res.has_value()) {
+                auto& [rule, replacement] = replace_res.value();
+
+                if (trace != nullptr && trace->wants_records()) {
+                    PosReplaceRecord record{
+                        rule_name.at(rule),
+                        cursor.get_pos(),
+                        current_term,
+                        cursor.get_focus(),
+                        replacement,
+                        nullptr
+                    };
+
+                    // rebuild the path to the matched subterm
+                    current_term = cursor.replace(replacement);
+                    record.final_term = current_term;
+                    trace->record(std::move(record));
+                }
+                else {
+                    current_term = cursor.replace(replacement);
+                    if (trace != nullptr) {
+                        trace->count(rule_name.at(rule));
+                    }
+                }
+                kernel.count_rewrite_step();
+            }
+            else {
+                break;
+            }
+        }
+        return current_term;
+    }
+
+    /**
+     * @brief The innermost rewriting. The arguments are normalized before the term, and after a rewriting only the
+     * result is normalized again. The normal forms are memoized for every context.
+     *
+     * For the trace, the arguments being normalized are kept on a stack, so that the whole term can be rebuilt at
+     * every step.
+     */
+    class InnermostRewriter {
+    protected:
+        struct Frame {
+            int head;
+            const ListArgs<int>* args;
+            unsigned int index;
+        };
 
-                current_term = current_term->replace_at(replace_res->pos, replace_res->replacement);
+        Kernel& kernel;
+        const RuleSet& rules;
+        TraceSink* trace;
 
+        std::unordered_map<TermContextKey, TermPtr<int>, TermContextKeyHash> normal_forms;
+        std::vector<Frame> frames;
+        // Whether the frames are kept, which is only needed to build the records.
+        bool keep_frames;
+
+        /**
+         * @brief Rebuild the whole term, with the given subterm at the current position.
+         */
+        TermPtr<int> rebuild(TermPtr<int> subterm) const {
+            for (auto it = frames.rbegin(); it != frames.rend(); ++it) {
+                auto new_args = *it->args;
+                new_args[it->index] = std::move(subterm);
+                subterm = create_term(it->head, std::move(new_args));
+            }
+            return subterm;
+        }
+
+        TermPos get_pos() const {
+            TermPos pos;
+            for (const auto& frame : frames) {
+                pos.push_back(frame.index);
+            }
+            return pos;
+        }
+
+        void record(std::string_view step, const TermPtr<int>& matched_term, const TermPtr<int>& replacement) {
+            _trace_step(trace, step, [&]() {
+                return PosReplaceRecord{
+                    std::string(step),
+                    get_pos(),
+                    rebuild(matched_term),
+                    matched_term,
+                    replacement,
+                    rebuild(replacement),
+                };
+            });
+        }
+
+        /**
+         * @brief Normalize the arguments of the term from left to right. The body of SSUM is not in a known context, so
+         * the binder is translated before the arguments are normalized.
+         */
+        TermPtr<int> normalize_args(TermPtr<int> term) {
+            if (term->get_head() == SSUM) {
+                auto apply_res = _apply_rules_renaming(kernel, term, rules);
+                if (apply_res.has_value()) {
+                    kernel.count_rewrite_step();
+                    if (trace != nullptr) {
+                        record(rule_name.at(apply_res->first), term, apply_res->second);
+                    }
+                    term = apply_res->second;
+                }
+            }
+
+            if (term->is_atomic()) {
+                return term;
+            }
+
+            auto head = term->get_head();
+            auto& args = term->get_args();
+            ListArgs<int> new_args(args.begin(), args.end());
+            bool changed = false;
+
+            for (unsigned int i = 0; i < new_args.size(); i++) {
+                if (!_is_searched_arg(head, i)) {
+                    continue;
+                }
+
+                bool pushed = _enter_arg(kernel, head, new_args, i);
+                if (keep_frames) {
+                    frames.push_back(Frame{head, &new_args, i});
+                }
+
+                auto nf = normalize(new_args[i]);
+
+                if (keep_frames) {
+                    frames.pop_back();
+                }
+                if (pushed) {
+                    kernel.context_pop();
+                }
+
+                if (nf != new_args[i]) {
+                    new_args[i] = std::move(nf);
+                    changed = true;
+                }
+            }
+
+            if (!changed) {
+                return term;
+            }
+            return create_term(head, std::move(new_args));
+        }
+
+    public:
+        InnermostRewriter(Kernel& kernel, const RuleSet& rules, TraceSink* trace) :
+            kernel(kernel), rules(rules), trace(trace), keep_frames(trace != nullptr && trace->wants_records()) {}
+
+        TermPtr<int> normalize(const TermPtr<int>& term) {
+            TermContextKey key{term, kernel.get_context_id()};
+            auto find_res = normal_forms.find(key);
+            // The reuses are not rewriting steps, so they are counted apart and not traced. For the records, a normal form
+            // other than the term itself is derived again, so that the records stay a chain of rewriting steps.
+            if (find_res != normal_forms.end() && (find_res->second == term || !keep_frames)) {
+                kernel.get_innermost_memo_stats().hits++;
+                auto nf = find_res->second;
+                if (nf == term || !may_contain_binder(*nf)) {
+                    return nf;
+                }
+
+                // the rules assume distinct bound variables, so the reused normal form with binders gets fresh ones
+                return bound_variable_rename(kernel, nf);
+            }
+            kernel.get_innermost_memo_stats().misses++;
+
+            auto current = normalize_args(term);
+            while (true) {
+                auto apply_res = _apply_rules_renaming(kernel, current, rules);
+                if (!apply_res.has_value()) {
+                    break;
+                }
+                kernel.count_rewrite_step();
                 if (trace != nullptr) {
-                    // assign the final term
-                    replace_res->final_term = current_term;
-                    trace->push_back(replace_res.value());
+                    record(rule_name.at(apply_res->first), current, apply_res->second);
+                }
+                current = normalize_args(apply_res->second);
+            }
+
+            normal_forms[key] = current;
+            return current;
+        }
+    };
+
+    /**
+     * @brief One sweep of the parallel-outermost rewriting. The outermost redexes are rewritten, and the results are not
+     * searched again in the same sweep. The subterms without redexes are recorded in the memo.
+     *
+     * @param step_num The number of the rewritings in this sweep.
+     * @param steps The sink of the rewritings in this sweep, from left to right. The records have the positions, matched
+     * terms and replacements only.
+     */
+    TermPtr<int> _rewrite_outermost_sweep(Kernel& kernel, const TermPtr<int>& term, const RuleSet& rules, IrreducibleMemo& memo, TermPos& current_pos, std::size_t& step_num, TraceSink* steps) {
+        if (memo.is_irreducible(kernel, term)) {
+            return term;
+        }
+
+        auto apply_res = _apply_rules_renaming(kernel, term, rules);
+        if (apply_res.has_value()) {
+            step_num++;
+            if (steps != nullptr) {
+                _trace_step(steps, rule_name.at(apply_res->first), [&]() {
+                    return PosReplaceRecord{rule_name.at(apply_res->first), current_pos, nullptr, term, apply_res->second, nullptr};
+                });
+            }
+            return apply_res->second;
+        }
+
+        auto head = term->get_head();
+        auto& args = term->get_args();
+
+        // the arguments are copied at the first rewriting inside
+        std::optional<ListArgs<int>> new_args;
+
+        for (unsigned int i = 0; i < args.size(); i++) {
+            if (!_is_searched_arg(head, i)) {
+                continue;
+            }
+
+            bool pushed = new_args.has_value() ? _enter_arg(kernel, head, *new_args, i) : _enter_arg(kernel, head, args, i);
+            current_pos.push_back(i);
+            auto new_arg = _rewrite_outermost_sweep(kernel, args[i], rules, memo, current_pos, step_num, steps);
+            current_pos.pop_back();
+            if (pushed) {
+                kernel.context_pop();
+            }
 
-                    // DEBUG PURPOSE
-                    // cout << record_to_string(kernel, replace_res.value()) << endl;
+            if (new_arg != args[i]) {
+                if (!new_args.has_value()) {
+                    new_args.emplace(args.begin(), args.end());
                 }
+                (*new_args)[i] = std::move(new_arg);
             }
-            else {
+        }
+
+        if (!new_args.has_value()) {
+            memo.set_irreducible(kernel, term);
+            return term;
+        }
+        return create_term(head, std::move(*new_args));
+    }
+
+    /**
+     * @brief The parallel-outermost rewriting: rewrite all the outermost redexes in one sweep, and repeat the sweeps.
+     */
+    TermPtr<int> _rewrite_parallel_outermost(Kernel& kernel, TermPtr<int> term, const RuleSet& rules, TraceSink* trace) {
+        auto current_term = term;
+        IrreducibleMemo memo;
+
+        // the records of a sweep are completed after it, and the steps are only counted otherwise
+        bool wants_records = trace != nullptr && trace->wants_records();
+        std::vector<PosReplaceRecord> steps;
+        RecordSink step_sink(steps);
+
+        while (true) {
+            TermPos current_pos;
+            std::size_t step_num = 0;
+            auto new_term = _rewrite_outermost_sweep(kernel, current_term, rules, memo, current_pos, step_num, wants_records ? &step_sink : trace);
+            if (step_num == 0) {
                 break;
             }
+
+            for (std::size_t i = 0; i < step_num; i++) {
+                kernel.count_rewrite_step();
+            }
+
+            // the redexes do not overlap, so they can be replayed one by one for the trace
+            for (auto& step : steps) {
+                step.init_term = current_term;
+                current_term = current_term->replace_at(step.pos, step.replacement);
+                step.final_term = current_term;
+                trace->record(std::move(step));
+            }
+            steps.clear();
+
+            current_term = new_term;
         }
         return current_term;
     }
 
+    TermPtr<int> pos_rewrite_repeated(Kernel& kernel, TermPtr<int> term, const RuleSet& rules, TraceSink* trace, RewriteStrategy strategy) {
+        switch (strategy) {
+            case RewriteStrategy::INNERMOST:
+                return InnermostRewriter(kernel, rules, trace).normalize(term);
+            case RewriteStrategy::PARALLEL_OUTERMOST:
+                return _rewrite_parallel_outermost(kernel, term, rules, trace);
+            default:
+                return _rewrite_leftmost_outermost(kernel, term, rules, trace);
+        }
+    }
+
     TermPtr<int> bound_variable_rename(Kernel& kernel, TermPtr<int> term) {
-        if (term->is_atomic()) {
+        if (term->is_atomic() || !may_contain_binder(*term)) {
             return term;
         }
 
+#if DHAMMER_LOCALLY_NAMELESS
+        // One pass to the locally nameless representation, and one pass back opening every binder with a fresh variable
+        return from_locally_nameless(kernel.get_sig(), to_locally_nameless(term));
+#else
+
         auto head = term->get_head();
         auto& args = term->get_args();
         auto new_args = ListArgs<int>();
@@ -141,7 +893,7 @@ namespace dhammer {
             auto type = bound_variable_rename(kernel, args[1]);
             auto body = bound_variable_rename(kernel, args[2]);
 
-            auto new_bound = create_term(sig.register_symbol(sig.unique_var()));
+            auto new_bound = create_term(sig.fresh_var());
 
             new_args.push_back(new_bound);
             new_args.push_back(subst(sig, type, args[0]->get_head(), new_bound));
@@ -151,7 +903,7 @@ namespace dhammer {
             // substitute inner bound variable first
             auto body = bound_variable_rename(kernel, args[1]);
 
-            auto new_bound = create_term(sig.register_symbol(sig.unique_var()));
+            auto new_bound = create_term(sig.fresh_var());
 
             new_args.push_back(new_bound);
             new_args.push_back(subst(sig, body, args[0]->get_head(), new_bound));
@@ -161,7 +913,7 @@ namespace dhammer {
             auto set = bound_variable_rename(kernel, args[1]);
             auto body = bound_variable_rename(kernel, args[2]);
 
-            auto new_bound = create_term(sig.register_symbol(sig.unique_var()));
+            auto new_bound = create_term(sig.fresh_var());
 
             new_args.push_back(new_bound);
             new_args.push_back(subst(sig, set, args[0]->get_head(), new_bound));
@@ -174,6 +926,7 @@ namespace dhammer {
         }
 
         return create_term(head, std::move(new_args));
+#endif
     }
 
 
@@ -186,11 +939,11 @@ namespace dhammer {
         if (term->is_atomic() || head == APPLY){
             auto type = kernel.calc_type(term);
             auto type_head = type->get_head();
-            auto type_args = type->get_args();
+            auto& type_args = type->get_args();
 
             // K : KTYPE(A) -> SUM(USET(A) FUN(i BASIS(A) SCR(DOT(BRA(i) K) KET(i))))
             if (type_head == KTYPE) {
-                auto new_bound = create_term(sig.register_symbol(sig.unique_var()));
+                auto new_bound = create_term(sig.fresh_var());
                 return create_term(
                     SUM,
                     {
@@ -212,7 +965,7 @@ namespace dhammer {
             
             // B : BTYPE(A) -> SUM(USET(A) FUN(i BASIS(A) SCR(DOT(B KET(i)) BRA(i))))
             else if (type_head == BTYPE) {
-                auto new_bound = create_term(sig.register_symbol(sig.unique_var()));
+                auto new_bound = create_term(sig.fresh_var());
                 return create_term(
                     SUM,
                     {
@@ -241,8 +994,8 @@ namespace dhammer {
             //                          ))
             //                    ))
             else if (type_head == OTYPE) {
-                auto new_bound_A = create_term(sig.register_symbol(sig.unique_var()));
-                auto new_bound_B = create_term(sig.register_symbol(sig.unique_var()));
+                auto new_bound_A = create_term(sig.fresh_var());
+                auto new_bound_B = create_term(sig.fresh_var());
 
                 return create_term(
                     SUM,
@@ -309,26 +1062,18 @@ namespace dhammer {
     }
 
 
-    void _get_bound_vars(TermPtr<int> term, std::set<int>& res) {
-        if (term->is_atomic()) {
-            return;
-        }
-
-        auto head = term->get_head();
-        auto args = term->get_args();
-
-        if (head == FUN) {
-            res.insert(args[0]->get_head());
-        }
-
-        for (const auto& arg : args) {
-            _get_bound_vars(arg, res);
-        }
+    void _get_bound_vars(TermRef<int> term, std::set<int>& res) {
+        visit_subterms<int>(term, [&](TermRef<int> subterm) {
+            if (subterm.get_head() == FUN) {
+                res.insert(subterm.get_args()[0]->get_head());
+            }
+            return true;
+        });
     }
 
     std::set<int> get_bound_vars(TermPtr<int> term) {
         std::set<int> res;
-        _get_bound_vars(term, res);
+        _get_bound_vars(*term, res);
         return res;
     }
 
@@ -347,12 +1092,12 @@ namespace dhammer {
      * @param bound_vars 
      * @return COMPARE_RESULT 
      */
-    COMPARE_RESULT _comp_modulo_bound_vars(TermPtr<int> termA, TermPtr<int> termB, std::set<int> bound_vars) {
-        auto headA = termA->get_head();
-        auto headB = termB->get_head();
+    COMPARE_RESULT _comp_modulo_bound_vars(TermRef<int> termA, TermRef<int> termB, const std::set<int>& bound_vars) {
+        auto headA = termA.get_head();
+        auto headB = termB.get_head();
 
-        auto argsA = termA->get_args();
-        auto argsB = termB->get_args();
+        auto& argsA = termA.get_args();
+        auto& argsB = termB.get_args();
 
 
         // bound variables are always larger than free variables, and they are equal to each other in order
@@ -376,7 +1121,7 @@ namespace dhammer {
         auto shortest_len = std::min(argsA.size(), argsB.size());
 
         for (int i = 0; i < shortest_len; i++) {
-            auto res = _comp_modulo_bound_vars(argsA[i], argsB[i], bound_vars);
+            auto res = _comp_modulo_bound_vars(*argsA[i], *argsB[i], bound_vars);
             if (res != EQUAL) {
                 return res;
             }
@@ -394,7 +1139,7 @@ namespace dhammer {
 
     bool comp_modulo_bound_vars(TermPtr<int> termA, TermPtr<int> termB, const std::set<int>& bound_vars) {
 
-        return _comp_modulo_bound_vars(termA, termB, bound_vars) == LESS;
+        return _comp_modulo_bound_vars(*termA, *termB, bound_vars) == LESS;
     }
     
 
@@ -407,19 +1152,19 @@ namespace dhammer {
      * @param vars_set 
      * @param vars 
      */
-    void _iter_for_order(TermPtr<int> term, std::set<int>& vars_set, std::vector<int>& vars, std::map<int, TermPtr<int>>& var_to_sumset) {
+    void _iter_for_order(TermRef<int> term, std::set<int>& vars_set, std::vector<int>& vars, std::map<int, TermPtr<int>>& var_to_sumset) {
         // NOTE: the set is used to store the bound variables that require ordering
 
-        if (term->is_atomic()) {
-            if (vars_set.find(term->get_head()) != vars_set.end()) {
-                vars.push_back(term->get_head());
-                vars_set.erase(term->get_head());
+        if (term.is_atomic()) {
+            if (vars_set.find(term.get_head()) != vars_set.end()) {
+                vars.push_back(term.get_head());
+                vars_set.erase(term.get_head());
             }
             return;
         }
 
-        auto head = term->get_head();
-        auto args = term->get_args();
+        auto head = term.get_head();
+        auto& args = term.get_args();
 
         if (head == FUN) {
             if (vars_set.find(args[0]->get_head()) == vars_set.end()) {
@@ -429,17 +1174,17 @@ namespace dhammer {
                 throw std::runtime_error("The bound variable is used twice.");
             }
 
-            _iter_for_order(args[2], vars_set, vars, var_to_sumset);
+            _iter_for_order(*args[2], vars_set, vars, var_to_sumset);
         }
         else {
             for (const auto& arg : args) {
-                _iter_for_order(arg, vars_set, vars, var_to_sumset);
+                _iter_for_order(*arg, vars_set, vars, var_to_sumset);
             }
         }
 
         // preserve teh sum sets for the bound variables
         if (head == SUM) {
-            auto fun = args[1];
+            auto& fun = args[1];
             if (fun->get_head() == FUN) {
                 auto var = fun->get_args()[0]->get_head();
                 if (var_to_sumset.find(var) == var_to_sumset.end()) {
@@ -463,7 +1208,7 @@ namespace dhammer {
         std::set<int> bound_vars_set;
         std::vector<int> bound_vars_order;
         std::map<int, TermPtr<int>> bound_vars_sumset;
-        _iter_for_order(term, bound_vars_set, bound_vars_order, bound_vars_sumset);
+        _iter_for_order(*term, bound_vars_set, bound_vars_order, bound_vars_sumset);
 
         // check whether bound_vars_sumset should be included in the order
         std::vector<pair<int, TermPtr<int>>> necessary_sum_vars;
@@ -563,7 +1308,7 @@ namespace dhammer {
 
         // get all the bound variables
         std::set<int> bound_vars;
-        _get_bound_vars(term, bound_vars);
+        _get_bound_vars(*term, bound_vars);
 
         // iterate through the term to get the order
         std::vector<int> bound_vars_order = get_order_of_bound_vars(term);
@@ -619,11 +1364,8 @@ namespace dhammer {
                 });
         }
 
-        // Call the Wolfram Engine
-        wstp::ast_to_WS(link, ast);
-
-        // Get the result
-        auto res_ast = wstp::WS_to_ast(link);
+        // Call the Wolfram Engine and get the result
+        auto res_ast = wstp::evaluate(link, ast);
         auto res_temp = sig.ast2term(res_ast);
 
         return res_temp;
@@ -934,7 +1676,7 @@ namespace dhammer {
 
     DHAMMER_RULE_DEF(R_DELTA, kernel, term) {
         auto find_res = kernel.find_in_env(term->get_head());
-        if (find_res != std::nullopt and find_res->is_def()) {
+        if (find_res != nullptr and find_res->is_def()) {
             // Note that the bound variable renaming is applied
             auto renamed_res = bound_variable_rename(kernel, find_res->def.value());
             return renamed_res;
@@ -1499,6 +2241,161 @@ namespace dhammer {
         return args_SCR_a_0O_T1_T2[1];
     }
 
+    /**
+     * @brief An argument of ADD/ADDS seen as a like term: `coef.core`, under `depth` levels of SUM binders.
+     * Arguments with equal keys and depths are merged, so the keys decide which cores count as alike. A null `coef`
+     * means the coefficient 1.
+     */
+    struct _LikeTerm {
+        TermPtr<int> key;
+        int depth;
+        TermPtr<int> coef;
+        TermPtr<int> core;
+    };
+
+    /**
+     * @brief Group the like terms with equal keys in one pass, by sorting their hashes.
+     * 
+     * @return The groups with at least two members, in the order of their first members. The members of each group
+     * are in the order of the arguments.
+     */
+    vector<vector<int>> _group_like_terms(const vector<_LikeTerm>& like_terms) {
+        vector<pair<size_t, int>> hashes;
+        hashes.reserve(like_terms.size());
+        for (int i = 0; i < like_terms.size(); i++) {
+            hashes.push_back({like_terms[i].key->get_hash() ^ size_t(like_terms[i].depth), i});
+        }
+        sort(hashes.begin(), hashes.end());
+
+        vector<vector<int>> groups;
+        vector<int> run;
+        for (int begin = 0, end; begin < hashes.size(); begin = end) {
+            end = begin + 1;
+            while (end < hashes.size() && hashes[end].first == hashes[begin].first) {
+                end++;
+            }
+            if (end - begin < 2) continue;
+
+            // Split the run of equal hashes by the keys. The indices in the run are ascending.
+            run.clear();
+            for (int k = begin; k < end; k++) {
+                run.push_back(hashes[k].second);
+            }
+            while (!run.empty()) {
+                auto& first = like_terms[run[0]];
+                vector<int> group;
+                vector<int> rest;
+                for (auto i : run) {
+                    if (like_terms[i].depth == first.depth && *like_terms[i].key == *first.key) {
+                        group.push_back(i);
+                    }
+                    else {
+                        rest.push_back(i);
+                    }
+                }
+                if (group.size() >= 2) {
+                    groups.push_back(std::move(group));
+                }
+                run = std::move(rest);
+            }
+        }
+
+        sort(groups.begin(), groups.end());
+        return groups;
+    }
+
+    /**
+     * @brief Replace each group of like terms by its merged term. The other arguments keep their order, and the merged
+     * terms are appended in the order of the groups.
+     */
+    template <class MergeFn>
+    TermPtr<int> _merge_like_term_groups(int head, const TermArgs<int>& args, const vector<vector<int>>& groups, MergeFn merge) {
+        vector<bool> merged(args.size(), false);
+        for (const auto& group : groups) {
+            for (auto i : group) {
+                merged[i] = true;
+            }
+        }
+
+        ListArgs<int> new_args;
+        for (int i = 0; i < args.size(); i++) {
+            if (!merged[i]) {
+                new_args.push_back(args[i]);
+            }
+        }
+        for (const auto& group : groups) {
+            new_args.push_back(merge(group));
+        }
+        return create_term(head, std::move(new_args));
+    }
+
+    // ADD(Y1 ... a1.X ... an.X ... Yn) -> ADD(Y1 ... Yn SCR(ADDS(a1 ... an) X)), for all the groups of like terms at once
+    // The cores are compared modulo the names of the bound variables, except the SUM cores: R_SUM_ADD1 splits their merged coefficients again, so they are merged modulo the names only by
+    // R_SUM_FACTOR. The scalar sums ADDS are not merged here, since their like terms need the arithmetic of the
+    // coefficients.
+    DHAMMER_RULE_DEF(R_ADD_MERGE, kernel, term) {
+
+        MATCH_HEAD(term, ADD, args_ADD_Y1_X_X_Yn)
+
+        if (args_ADD_Y1_X_X_Yn.size() < 2) return std::nullopt;
+
+        vector<_LikeTerm> like_terms;
+        like_terms.reserve(args_ADD_Y1_X_X_Yn.size());
+        // The cores that may contain binders
+        vector<int> binder_cores;
+        for (const auto& arg : args_ADD_Y1_X_X_Yn) {
+            if (arg->get_head() == SCR) {
+                auto& args_SCR_a_X = arg->get_args();
+                like_terms.push_back({args_SCR_a_X[1], 0, args_SCR_a_X[0], args_SCR_a_X[1]});
+            }
+            else {
+                like_terms.push_back({arg, 0, nullptr, arg});
+            }
+
+            auto& core = like_terms.back().core;
+            if (core->get_head() != SUM && may_contain_binder(*core)) {
+                binder_cores.push_back(like_terms.size() - 1);
+            }
+        }
+
+        // Only the cores with binders may be alpha equivalent without being equal. They are bucketed by the hashes of
+        // their locally nameless forms, and each of them is keyed by the first alpha equivalent core in its bucket.
+        if (binder_cores.size() >= 2) {
+            unordered_map<size_t, vector<int>> leaders;
+            for (auto i : binder_cores) {
+                auto& like_term = like_terms[i];
+                bool has_binder = false;
+                auto h = alpha_hash(*like_term.core, has_binder);
+                if (!has_binder) {
+                    continue;
+                }
+                auto& bucket = leaders[h];
+                auto find = find_if(bucket.begin(), bucket.end(), [&](int l) {
+                    return is_alpha_eq(*like_terms[l].core, *like_term.core);
+                });
+                if (find == bucket.end()) {
+                    bucket.push_back(i);
+                }
+                else {
+                    like_term.key = like_terms[*find].core;
+                }
+            }
+        }
+
+        auto groups = _group_like_terms(like_terms);
+        if (groups.empty()) return std::nullopt;
+
+        return _merge_like_term_groups(ADD, args_ADD_Y1_X_X_Yn, groups,
+            [&](const vector<int>& group) {
+                ListArgs<int> coefs;
+                for (auto i : group) {
+                    coefs.push_back(like_terms[i].coef == nullptr ? create_term(ONE) : like_terms[i].coef);
+                }
+                return create_term(SCR, {create_term(ADDS, std::move(coefs)), like_terms[group[0]].core});
+            }
+        );
+    }
+
     // ADD(X) -> X
     DHAMMER_RULE_DEF(R_ADDID, kernel, term) {
 
@@ -2893,7 +3790,7 @@ namespace dhammer {
 
         MATCH_HEAD(term, ONEO, args_ONEO_T)
 
-        auto new_var_int = kernel.register_symbol(sig.unique_var());
+        auto new_var_int = sig.fresh_var();
         auto new_var = create_term(new_var_int);
 
         return create_term(SUM, 
@@ -3905,7 +4802,7 @@ namespace dhammer {
 
         ListArgs<int> new_sum_args;
         for (const auto &arg : args_ADDS_a1_an) {
-            auto new_var = create_term(kernel.register_symbol(sig.unique_var()));
+            auto new_var = create_term(sig.fresh_var());
             new_sum_args.push_back(create_term(SUM, 
                 {
                     args_SUM_M_fun_i_T_ADDS_a1_an[0],
@@ -3942,7 +4839,7 @@ namespace dhammer {
 
                 ListArgs<int> new_sum_args;
                 for (const auto &arg : args_ADDS_a1_an) {
-                    auto new_var = create_term(kernel.register_symbol(sig.unique_var()));
+                    auto new_var = create_term(sig.fresh_var());
                     ListArgs<int> new_mul_args{args_MULS_b1_ADDS_a1_an_bm};
                     new_mul_args[i] = arg;
                     new_sum_args.push_back(create_term(SUM, 
@@ -3979,7 +4876,7 @@ namespace dhammer {
 
         ListArgs<int> new_sum_args;
         for (const auto &arg : args_ADD_a1_an) {
-            auto new_var = create_term(kernel.register_symbol(sig.unique_var()));
+            auto new_var = create_term(sig.fresh_var());
             new_sum_args.push_back(create_term(SUM, 
                 {
                     args_SUM_M_fun_i_T_ADD_a1_an[0],
@@ -4014,7 +4911,7 @@ namespace dhammer {
         ListArgs<int> new_sum_args;
 
         for (const auto &arg : args_ADDS_a1_an_X) {
-            auto new_var = create_term(kernel.register_symbol(sig.unique_var()));
+            auto new_var = create_term(sig.fresh_var());
             new_sum_args.push_back(create_term(SUM, 
                 {
                     args_SUM_M_fun_i_T_SCR_ADDS_a1_an_X[0],
@@ -4048,8 +4945,8 @@ namespace dhammer {
 
         if (args_Basis_Prod_T1_T2[0]->get_head() != PROD) return std::nullopt;
 
-        TermPtr<int> j = create_term(kernel.register_symbol(sig.unique_var()));
-        TermPtr<int> k = create_term(kernel.register_symbol(sig.unique_var()));
+        TermPtr<int> j = create_term(sig.fresh_var());
+        TermPtr<int> k = create_term(sig.fresh_var());
 
         return create_term(SUM, 
             {
@@ -4092,8 +4989,8 @@ namespace dhammer {
 
         MATCH_HEAD(args_BASIS_Prod_T1_T2[0], PROD, args_Prod_T1_T2)
 
-        TermPtr<int> j = create_term(kernel.register_symbol(sig.unique_var()));
-        TermPtr<int> k = create_term(kernel.register_symbol(sig.unique_var()));
+        TermPtr<int> j = create_term(sig.fresh_var());
+        TermPtr<int> k = create_term(sig.fresh_var());
 
         return create_term(SUM, 
             {
@@ -4120,89 +5017,89 @@ namespace dhammer {
         );
     }
 
-    // return the factorized result
-    optional<TermPtr<int>> sum_to_factorize(Kernel& kernel, TermPtr<int> termA, TermPtr<int> termB, vector<pair<int, int>>& bound_var_corr) {
-
-        auto headA = termA->get_head();
-        auto headB = termB->get_head();
-        auto argsA = termA->get_args();
-        auto argsB = termB->get_args();
-
-        if (headA == SUM && headB == SUM && argsA[1]->get_head() == FUN && argsB[1]->get_head() == FUN) {
-            auto& argsA_body = argsA[1]->get_args();
-            auto& argsB_body = argsB[1]->get_args();
-
-            // The types should be equivalent
-            if (*argsA_body[1] == *argsB_body[1]) {    
-                auto bound_varA = argsA_body[0];
-                auto bound_varB = argsB_body[0];
-                
-                bound_var_corr.push_back({bound_varA->get_head(), bound_varB->get_head()});
-                auto inner_res = sum_to_factorize(kernel, argsA_body[2], argsB_body[2], bound_var_corr);
-                bound_var_corr.pop_back();
-
-                if (!inner_res) return std::nullopt;
-
-                return create_term(SUM, {argsA[0], create_term(FUN, {bound_varA, argsA_body[1], inner_res.value()})});
-            }
-        }
-
-        // replace the bound variables on termB
-        auto new_termB = termB;
-        for (const auto& [varA, varB] : bound_var_corr) {
-            new_termB = subst(kernel.get_sig(), new_termB, varB, create_term(varA));
-        }
-
-        headB = new_termB->get_head();
-        argsB = new_termB->get_args();
-
-        // A + A -> (1 + 1).A
-        if (*termA == *new_termB) {
-            return create_term(SCR, {create_term(ADDS, {create_term(ONE), create_term(ONE)}), termA});
-        }
+    // Rebuild the chain of `depth` SUM binders of `term`, with `bottom` as the innermost body.
+    TermPtr<int> _rebuild_sum_chain(const TermPtr<int>& term, int depth, TermPtr<int> bottom) {
+        if (depth == 0) return bottom;
 
-        // a.A + A -> (a + 1).A
-        else if (headA == SCR && *argsA[1] == *new_termB) {
-            return create_term(SCR, {create_term(ADDS, {argsA[0], create_term(ONE)}), new_termB});
-        }
-
-        // A + a.A -> (1 + a).A
-        else if (headB == SCR && *termA == *argsB[1]) {
-            return create_term(SCR, {create_term(ADDS, {create_term(ONE), argsB[0]}), termA});
-        }
+        auto& args_SUM_M_fun_i_T_X = term->get_args();
+        auto& args_FUN_i_T_X = args_SUM_M_fun_i_T_X[1]->get_args();
+        return create_term(SUM, {
+            args_SUM_M_fun_i_T_X[0],
+            create_term(FUN, {args_FUN_i_T_X[0], args_FUN_i_T_X[1], _rebuild_sum_chain(args_FUN_i_T_X[2], depth - 1, bottom)})
+        });
+    }
 
-        // a.A + b.A -> (a + b).A
-        else if (headA == SCR && headB == SCR && *argsA[1] == *argsB[1]) {
-            return create_term(SCR, {create_term(ADDS, {argsA[0], argsB[0]}), argsA[1]});
-        }
-        else {
-            return std::nullopt;
+    // Collect the bound variables of the chain of SUM binders of `term`.
+    void _sum_chain_vars(const TermPtr<int>& term, int depth, vector<int>& vars) {
+        auto current = term;
+        for (int d = 0; d < depth; d++) {
+            auto& args_FUN_i_T_X = current->get_args()[1]->get_args();
+            vars.push_back(args_FUN_i_T_X[0]->get_head());
+            current = args_FUN_i_T_X[2];
         }
     }
 
+    // SUM(M fun i T. ... a1.X) + ... + SUM(M fun j T. ... an.X{i/j}) -> SUM(M fun i T. ... ADDS(a1 ... an{j/i}).X)
+    // The like terms are compared modulo the names of the bound variables, and all the groups are merged at once.
     DHAMMER_RULE_DEF(R_SUM_FACTOR, kernel, term) {
         auto head = term->get_head();
-        auto args = term->get_args();
+        auto& args = term->get_args();
         if (head != ADD && head != ADDS) return std::nullopt;
+        if (args.size() < 2) return std::nullopt;
 
-        // Find the two terms that can be factorized
-        for (int i = 0; i < args.size(); i++) {
-            for (int j = i + 1; j < args.size(); j++) {
-                vector<pair<int, int>> bound_var_corr;
-                auto factorized = sum_to_factorize(kernel, args[i], args[j], bound_var_corr);
-                if (factorized) {
-                    ListArgs<int> new_args;
-                    for (int k = 0; k < args.size(); k++) {
-                        if (k == i || k == j) continue;
-                        new_args.push_back(args[k]);
+        auto& sig = kernel.get_sig();
+
+        vector<_LikeTerm> like_terms;
+        like_terms.reserve(args.size());
+        for (const auto& arg : args) {
+            // Go through the SUM binders
+            int depth = 0;
+            auto body = arg;
+            while (body->get_head() == SUM && body->get_args()[1]->get_head() == FUN) {
+                body = body->get_args()[1]->get_args()[2];
+                depth++;
+            }
+
+            TermPtr<int> coef = nullptr;
+            auto core = body;
+            if (body->get_head() == SCR) {
+                coef = body->get_args()[0];
+                core = body->get_args()[1];
+            }
+
+            // Only the SUM binder chains need the de Bruijn keys. The other cores are compared as they are.
+            auto key = depth == 0 ? core : to_deBruijn(sig, _rebuild_sum_chain(arg, depth, core));
+            like_terms.push_back({key, depth, coef, core});
+        }
+
+        auto groups = _group_like_terms(like_terms);
+        if (groups.empty()) return std::nullopt;
+
+        return _merge_like_term_groups(head, args, groups,
+            [&](const vector<int>& group) {
+                auto& first = like_terms[group[0]];
+                vector<int> first_vars;
+                _sum_chain_vars(args[group[0]], first.depth, first_vars);
+
+                ListArgs<int> coefs;
+                vector<int> vars;
+                for (auto i : group) {
+                    auto coef = like_terms[i].coef == nullptr ? create_term(ONE) : like_terms[i].coef;
+
+                    // Rename the bound variables to those of the first like term
+                    vars.clear();
+                    _sum_chain_vars(args[i], first.depth, vars);
+                    for (int d = 0; d < vars.size(); d++) {
+                        if (vars[d] != first_vars[d]) {
+                            coef = subst(sig, coef, vars[d], create_term(first_vars[d]));
+                        }
                     }
-                    new_args.push_back(factorized.value());
-                    return create_term(head, std::move(new_args));
+                    coefs.push_back(coef);
                 }
-            }
-        }
 
-        return std::nullopt;
+                return _rebuild_sum_chain(args[group[0]], first.depth, create_term(SCR, {create_term(ADDS, std::move(coefs)), first.core}));
+            }
+        );
     }
 
 
@@ -4275,7 +5172,7 @@ namespace dhammer {
             auto type = kernel.calc_type(reg);
             if (type->get_head() != REG) throw std::runtime_error("get_L_expand_info: not a register");
 
-            auto new_bound = kernel.register_symbol(kernel.get_sig().unique_var());
+            auto new_bound = kernel.get_sig().fresh_var();
             return {create_term(new_bound), vector{L_expand_element{new_bound, type->get_args()[0], reg->get_head()}}};
         }
 
@@ -4974,7 +5871,7 @@ namespace dhammer {
 
     }
 
-    const std::vector<PosRewritingRule> rules = {
+    const RuleSet rules = {
 
         // pre processing rules
         R_COMPO_SS, R_COMPO_SK, R_COMPO_SB, R_COMPO_SO,
@@ -4998,7 +5895,7 @@ namespace dhammer {
 
         R_SCR0, R_SCR1, R_SCR2, R_SCRK0, R_SCRK1, R_SCRB0, R_SCRB1, R_SCRO0, R_SCRO1,
 
-        R_ADDID, R_ADD0, R_ADD1, R_ADD2, R_ADD3, R_ADDK0, R_ADDB0, R_ADDO0,
+        R_ADDID, R_ADD_MERGE, R_ADDK0, R_ADDB0, R_ADDO0,
 
         R_ADJ0, R_ADJ1, R_ADJ2, R_ADJ3, R_ADJK0, R_ADJK1, R_ADJK2, R_ADJB0, R_ADJB1, R_ADJB2, R_ADJO0, R_ADJO1, R_ADJO2, R_ADJO3,
 
@@ -5031,7 +5928,7 @@ namespace dhammer {
         R_L_SORT0, R_L_SORT1, R_L_SORT2, R_L_SORT3, R_L_SORT4
     };
 
-    const std::vector<PosRewritingRule> rules_with_wolfram_distr = {
+    const RuleSet rules_with_wolfram_distr = {
 
         // pre processing rules
         R_COMPO_SS, R_COMPO_SK, R_COMPO_SB, R_COMPO_SO,
@@ -5055,7 +5952,7 @@ namespace dhammer {
 
         R_SCR0, R_SCR1, R_SCR2, R_SCRK0, R_SCRK1, R_SCRB0, R_SCRB1, R_SCRO0, R_SCRO1,
 
-        R_ADDID, R_ADD0, R_ADD1, R_ADD2, R_ADD3, R_ADDK0, R_ADDB0, R_ADDO0,
+        R_ADDID, R_ADD_MERGE, R_ADDK0, R_ADDB0, R_ADDO0,
 
         R_ADJ0, R_ADJ1, R_ADJ2, R_ADJ3, R_ADJK0, R_ADJK1, R_ADJK2, R_ADJB0, R_ADJB1, R_ADJB2, R_ADJO0, R_ADJO1, R_ADJO2, R_ADJO3,
 
@@ -5090,7 +5987,7 @@ namespace dhammer {
 
 
 
-    const std::vector<PosRewritingRule> rules_with_wolfram_merge = {
+    const RuleSet rules_with_wolfram_merge = {
 
         // pre processing rules
         R_COMPO_SS, R_COMPO_SK, R_COMPO_SB, R_COMPO_SO,
@@ -5114,7 +6011,7 @@ namespace dhammer {
 
         R_SCR0, R_SCR1, R_SCR2, R_SCRK0, R_SCRK1, R_SCRB0, R_SCRB1, R_SCRO0, R_SCRO1,
 
-        R_ADDID, R_ADD0, R_ADD1, R_ADD2, R_ADD3, R_ADDK0, R_ADDB0, R_ADDO0,
+        R_ADDID, R_ADD_MERGE, R_ADDK0, R_ADDB0, R_ADDO0,
 
         R_ADJ0, R_ADJ1, R_ADJ2, R_ADJ3, R_ADJK0, R_ADJK1, R_ADJK2, R_ADJB0, R_ADJB1, R_ADJB2, R_ADJO0, R_ADJO1, R_ADJO2, R_ADJO3,
 
@@ -3,6 +3,22 @@
 #include "ualg.hpp"
 #include "WSTPinterface.hpp"
 
+#include <array>
+#include <span>
+#include <string_view>
+#include <unordered_set>
+
+// Set DHAMMER_RULE_PROFILING to 0 to compile out the per-rule profiling counters in get_pos_replace.
+#ifndef DHAMMER_RULE_PROFILING
+#define DHAMMER_RULE_PROFILING 1
+#endif
+
+// Set DHAMMER_RULE_INDEX to 0 to try the whole rule list on every term instead of the candidates from the index, as
+// the reference for benchmarks.
+#ifndef DHAMMER_RULE_INDEX
+#define DHAMMER_RULE_INDEX 1
+#endif
+
 namespace dhammer {
 
     // The rewriting rules of the D-Hammer kernel.
@@ -20,6 +36,164 @@ namespace dhammer {
         ualg::TermPtr<int> final_term;
     };
 
+    /**
+     * @brief The receiver of the rewriting steps of pos_rewrite_repeated.
+     *
+     * The records are built only if the sink wants them. Otherwise the rewriters only report the names of the steps,
+     * which refer to static strings, so that no allocation is made for the steps.
+     */
+    class TraceSink {
+    public:
+        virtual ~TraceSink() = default;
+
+        virtual bool wants_records() const = 0;
+
+        /**
+         * @brief Receive the name of a step. It is called instead of `record` if the records are not wanted.
+         */
+        virtual void count(std::string_view step) {}
+
+        /**
+         * @brief Receive the record of a step. It is called only if the records are wanted.
+         */
+        virtual void record(PosReplaceRecord&& record) {}
+    };
+
+    /**
+     * @brief The sink keeping the records in a vector.
+     */
+    class RecordSink : public TraceSink {
+    protected:
+        std::vector<PosReplaceRecord>& records;
+
+    public:
+        RecordSink(std::vector<PosReplaceRecord>& records) : records(records) {}
+
+        bool wants_records() const override {
+            return true;
+        }
+
+        void record(PosReplaceRecord&& record) override {
+            records.push_back(std::move(record));
+        }
+    };
+
+
+    // The wildcard in the argument heads of a rule pattern.
+    constexpr int ANY_HEAD = -1;
+
+    /**
+     * @brief The syntactic pattern of the left-hand side of a rule, down to the heads of the arguments.
+     *
+     * `heads` are the head symbols of the terms that the rule can match. An empty list means any head. `arg_heads[i]`
+     * is the head that the argument i must have, or ANY_HEAD. A term with fewer arguments does not match. The pattern
+     * only needs to be necessary for the rule to apply: the rule still checks the term itself.
+     */
+    struct RulePattern {
+        std::vector<int> heads;
+        std::vector<int> arg_heads;
+    };
+
+    /**
+     * @brief Get the pattern of the rule.
+     * 
+     * The registry is used to build the indices of rule sets. The rules not in the registry can match any term.
+     * 
+     * @param rule 
+     * @return const RulePattern& 
+     */
+    const RulePattern& get_rule_pattern(PosRewritingRule rule);
+
+    /**
+     * @brief Get the head symbols of the terms that the rule can match. An empty list means any head.
+     */
+    inline const std::vector<int>& get_rule_heads(PosRewritingRule rule) {
+        return get_rule_pattern(rule).heads;
+    }
+
+
+    /**
+     * @brief The set of rewriting rules, indexed by the patterns of the rules.
+     * 
+     * The index is a discrimination tree over the head of the term and the heads of its arguments. A walk over the top
+     * two levels of a term gives the candidate rules, i.e., the rules whose patterns match, in the same order as the
+     * rule list. Therefore trying the candidates gives the same result as trying the whole list. The index is
+     * compiled on the first use.
+     */
+    class RuleSet {
+    protected:
+        struct IndexNode {
+            // the indices of the rules whose patterns end at this node, in increasing order
+            std::vector<int> rules;
+            // the children for the next head in the pattern, sorted by the head, and the child for ANY_HEAD
+            std::vector<std::pair<int, int>> children;
+            int any_child = -1;
+        };
+
+        // The index keys are the head and the first argument heads. A term reaches at most two nodes (the exact head
+        // and ANY_HEAD) from every node, so at most 2^(max_index_depth + 1) - 1 nodes in total.
+        static constexpr std::size_t max_index_depth = 3;
+        static constexpr std::size_t max_candidate_lists = (1 << (max_index_depth + 1)) - 1;
+
+        std::vector<PosRewritingRule> rules;
+
+        mutable std::once_flag compile_flag;
+        // the nodes of the index, where the node 0 is the root, and the children of the root by the head
+        mutable std::vector<IndexNode> index;
+        mutable std::vector<int> root_children;
+
+        void compile() const;
+
+        void insert_pattern(int rule_id, const RulePattern& pattern) const;
+
+    public:
+        /**
+         * @brief The candidate rules of a term, merged from the lists at the index nodes reached by the term.
+         */
+        class Candidates {
+        protected:
+            const std::vector<PosRewritingRule>* rules;
+            std::array<std::span<const int>, max_candidate_lists> lists;
+            std::size_t list_num = 0;
+
+            friend class RuleSet;
+
+        public:
+            /**
+             * @brief The next candidate in the order of the rule list, or nullptr if there is none.
+             */
+            PosRewritingRule next();
+        };
+
+        RuleSet(std::initializer_list<PosRewritingRule> rules);
+        RuleSet(const std::vector<PosRewritingRule>& rules);
+        RuleSet(const RuleSet& other);
+
+        const std::vector<PosRewritingRule>& get_rules() const;
+
+        /**
+         * @brief Get the candidate rules for the term from the index.
+         */
+        Candidates get_candidates(ualg::TermRef<int> term) const;
+    };
+
+
+    /**
+     * @brief The record of the subterms proven irreducible during one rewriting process.
+     * 
+     * A subterm is identified by its (interned) node together with the context id of the kernel, because the
+     * applicability of the rules depends on the types of the bound variables. The record is only valid for a fixed
+     * rule set and a fixed environment.
+     */
+    class IrreducibleMemo {
+    protected:
+        std::unordered_set<TermContextKey, TermContextKeyHash> irreducible_terms;
+
+    public:
+        bool is_irreducible(const Kernel& kernel, ualg::TermPtr<int> term) const;
+        void set_irreducible(const Kernel& kernel, ualg::TermPtr<int> term);
+    };
+
 
     /**
      * @brief Get the rewriting record using the rewriting rules.
@@ -29,20 +203,37 @@ namespace dhammer {
      * @param rules 
      * @return std::optional<PosReplaceRecord> 
      */
-    std::optional<PosReplaceRecord> get_pos_replace(Kernel& kernel, ualg::TermPtr<int> term, const std::vector<PosRewritingRule>& rules);
+    std::optional<PosReplaceRecord> get_pos_replace(Kernel& kernel, ualg::TermPtr<int> term, const RuleSet& rules);
 
 
     /**
      * @brief Rewrite the term repeatedly using the given rewriting rules, until no more rules can apply.
      * 
+     * The rewriting is leftmost-outermost by default. The subterms found irreducible are recorded, so that the search
+     * after a rewriting step only revisits the changed path and the new subterms. See RewriteStrategy for the other
+     * strategies. Every step is recorded in the trace with the whole term before and after it, whatever the strategy.
+     * 
      * @param kernel 
      * @param term 
      * @param rules 
-     * @param trace The container to store the trace of the rewriting.
+     * @param trace The sink of the rewriting steps, or nullptr for no trace.
+     * @param strategy The strategy to choose the redexes.
      * @return const NormalTerm<int>* 
      */
-    ualg::TermPtr<int> pos_rewrite_repeated(Kernel& kernel, ualg::TermPtr<int> term, const std::vector<PosRewritingRule>& rules, 
-    std::vector<PosReplaceRecord>* trace = nullptr);
+    ualg::TermPtr<int> pos_rewrite_repeated(Kernel& kernel, ualg::TermPtr<int> term, const RuleSet& rules, 
+    TraceSink* trace = nullptr, RewriteStrategy strategy = RewriteStrategy::LEFTMOST_OUTERMOST);
+
+    /**
+     * @brief The same as above, with the records stored in the vector.
+     */
+    inline ualg::TermPtr<int> pos_rewrite_repeated(Kernel& kernel, ualg::TermPtr<int> term, const RuleSet& rules,
+    std::vector<PosReplaceRecord>* trace, RewriteStrategy strategy = RewriteStrategy::LEFTMOST_OUTERMOST) {
+        if (trace == nullptr) {
+            return pos_rewrite_repeated(kernel, term, rules, static_cast<TraceSink*>(nullptr), strategy);
+        }
+        RecordSink sink(*trace);
+        return pos_rewrite_repeated(kernel, term, rules, &sink, strategy);
+    }
 
     /**
      * @brief This function rename all the bound variables in the term and return the result.
@@ -353,6 +544,9 @@ namespace dhammer {
     // ADD(Y1 ... SCR(a X) ... SCR(b X) ... Yn) -> ADD(Y1 ... Yn SCR(ADDS(a b) X))
     DHAMMER_RULE_DEF(R_ADD3, kernel, term);
 
+    // ADD(Y1 ... a1.X ... an.X ... Yn) -> ADD(Y1 ... Yn SCR(ADDS(a1 ... an) X)), for all the groups of like terms at once
+    DHAMMER_RULE_DEF(R_ADD_MERGE, kernel, term);
+
     // ADD(K1 ... 0K(T) ... Kn) -> ADD(K1 ... Kn)
     DHAMMER_RULE_DEF(R_ADDK0, kernel, term);
 
@@ -689,7 +883,7 @@ namespace dhammer {
     // SUM(CATPROD(M1 M2) FUN(i BASIS(PROD(T1 T2)) X)) -> SUM(M1 FUN(j BASIS(T1) SUM(M2 FUN(k BASIS(T2) X{i/PAIR(j k)})))
     DHAMMER_RULE_DEF(R_SUM_INDEX1, kernel, term);
 
-    // factorization addition of the sum
+    // SUM(M fun i T. ... a1.X) + ... + SUM(M fun j T. ... an.X{i/j}) -> SUM(M fun i T. ... ADDS(a1 ... an{j/i}).X)
     DHAMMER_RULE_DEF(R_SUM_FACTOR, kernel, term);
 
 
@@ -792,14 +986,14 @@ namespace dhammer {
     DHAMMER_RULE_DEF(R_L_SORT4, kernel, term);
 
     // The rule list.
-    extern const std::vector<PosRewritingRule> rules;
+    extern const RuleSet rules;
 
 
     // The rule list when combined with wolfram engine. (scalar rules are not included)
     // distribute rules
-    extern const std::vector<PosRewritingRule> rules_with_wolfram_distr;
+    extern const RuleSet rules_with_wolfram_distr;
     // merge rules
-    extern const std::vector<PosRewritingRule> rules_with_wolfram_merge;
+    extern const RuleSet rules_with_wolfram_merge;
 
     ///////////////// Trace Output
 
@@ -26,6 +26,7 @@ namespace dhammer {
             "SHOWALL",
             "NORMALIZE",
             "CHECKEQ",
+            "PROFILE",
             "TRACE",
 
             "COMPO",
@@ -8,12 +8,18 @@ namespace dhammer {
 
     template <class T>
     inline ualg::TermPtr<T> create_term(const T& head) {
-        return std::make_shared<const ualg::Term<T>>(head);
+        return ualg::make_term(head);
     }
 
     template <class T>
     inline ualg::TermPtr<T> create_term(const T& head, ualg::ListArgs<T> args) {
-        return std::make_shared<const ualg::Term<T>>(head, std::move(args));
+        return ualg::make_term(head, std::move(args));
+    }
+
+    // Create the term with the arguments of another term. (The argument type is deduced, so that brace-enclosed lists still go to the ListArgs version.)
+    template <class T, class Args> requires std::is_same_v<Args, ualg::TermArgs<T>>
+    inline ualg::TermPtr<T> create_term(const T& head, const Args& args) {
+        return ualg::make_term(head, args.to_vector());
     }
 
     extern const int deBruijn_index_num;
@@ -55,4 +55,240 @@ namespace dhammer {
         vector<int> bound_var_stack;
         return to_deBruijn(sig, term, bound_var_stack);
     }
+
+    // Whether the term is a binder with a named variable: FUN(x T B), IDX(x B), FORALL(x B) or SSUM(x S B).
+    inline bool _is_named_binder(int head, std::size_t arg_num) {
+        return ((head == FUN || head == SSUM) && arg_num == 3) || ((head == IDX || head == FORALL) && arg_num == 2);
+    }
+
+    // Whether the term is a locally nameless binder: FUN(T B), IDX(B), FORALL(B) or SSUM(S B).
+    inline bool _is_ln_binder(int head, std::size_t arg_num) {
+        return ((head == FUN || head == SSUM) && arg_num == 2) || ((head == IDX || head == FORALL) && arg_num == 1);
+    }
+
+    bool is_alpha_eq(TermRef<int> termA, TermRef<int> termB, vector<pair<int, int>>& bound_vars) {
+        if (&termA == &termB) {
+            // a shared subterm is alpha equivalent to itself, unless it refers to the bound variables
+            bool refers_bound = false;
+            for (const auto& [varA, varB] : bound_vars) {
+                if (termA.may_contain(varA) || termA.may_contain(varB)) {
+                    refers_bound = true;
+                    break;
+                }
+            }
+            if (!refers_bound) {
+                return true;
+            }
+        }
+
+        auto headA = termA.get_head();
+        auto headB = termB.get_head();
+        auto& argsA = termA.get_args();
+        auto& argsB = termB.get_args();
+        if (argsA.size() != argsB.size()) {
+            return false;
+        }
+
+        if (argsA.size() == 0) {
+            // the innermost binder of either variable decides
+            for (auto it = bound_vars.rbegin(); it != bound_vars.rend(); ++it) {
+                if (it->first == headA || it->second == headB) {
+                    return it->first == headA && it->second == headB;
+                }
+            }
+            return headA == headB;
+        }
+
+        if (headA != headB) {
+            return false;
+        }
+
+        if (_is_named_binder(headA, argsA.size())) {
+            // the arguments between the variable and the body are not in the scope of the variable
+            for (int i = 1; i < argsA.size() - 1; i++) {
+                if (!is_alpha_eq(*argsA[i], *argsB[i], bound_vars)) {
+                    return false;
+                }
+            }
+            bound_vars.push_back({argsA[0]->get_head(), argsB[0]->get_head()});
+            auto res = is_alpha_eq(*argsA.back(), *argsB.back(), bound_vars);
+            bound_vars.pop_back();
+            return res;
+        }
+
+        for (int i = 0; i < argsA.size(); i++) {
+            if (!is_alpha_eq(*argsA[i], *argsB[i], bound_vars)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool is_alpha_eq(TermRef<int> termA, TermRef<int> termB) {
+        vector<pair<int, int>> bound_vars;
+        return is_alpha_eq(termA, termB, bound_vars);
+    }
+
+    std::size_t alpha_hash(TermRef<int> term, vector<int>& bound_var_stack, bool& has_binder) {
+        auto head = term.get_head();
+
+        if (term.is_atomic()) {
+            auto search_res = search_bound(bound_var_stack, head);
+            if (search_res == -1) {
+                return term.get_hash();
+            }
+            return Term<int>::calc_hash(ln_index(search_res), {});
+        }
+
+        // a subterm without binders and bound variables is its own locally nameless form
+        if (!may_contain_binder(term) && none_of(bound_var_stack.begin(), bound_var_stack.end(), [&](int var) { return term.may_contain(var); })) {
+            return term.get_hash();
+        }
+
+        auto& args = term.get_args();
+        std::size_t h = std::hash<int>{}(head);
+
+        if (_is_named_binder(head, args.size())) {
+            has_binder = true;
+            // the arguments between the variable and the body are not in the scope of the variable
+            for (int i = 1; i < args.size() - 1; i++) {
+                h = Term<int>::combine_hash(h, alpha_hash(*args[i], bound_var_stack, has_binder));
+            }
+            bound_var_stack.push_back(args[0]->get_head());
+            h = Term<int>::combine_hash(h, alpha_hash(*args.back(), bound_var_stack, has_binder));
+            bound_var_stack.pop_back();
+            return h;
+        }
+
+        for (const auto& arg : args) {
+            h = Term<int>::combine_hash(h, alpha_hash(*arg, bound_var_stack, has_binder));
+        }
+        return h;
+    }
+
+    std::size_t alpha_hash(TermRef<int> term, bool& has_binder) {
+        vector<int> bound_var_stack;
+        return alpha_hash(term, bound_var_stack, has_binder);
+    }
+
+    TermPtr<int> to_locally_nameless(TermPtr<int> term, vector<int>& bound_var_stack) {
+        auto head = term->get_head();
+
+        if (term->is_atomic()) {
+            auto search_res = search_bound(bound_var_stack, head);
+            if (search_res == -1) {
+                return term;
+            }
+            return create_term(ln_index(search_res));
+        }
+
+        auto& args = term->get_args();
+        ListArgs<int> new_args;
+
+        if (_is_named_binder(head, args.size())) {
+            // the arguments between the variable and the body are not in the scope of the variable
+            for (int i = 1; i < args.size() - 1; i++) {
+                new_args.push_back(to_locally_nameless(args[i], bound_var_stack));
+            }
+            bound_var_stack.push_back(args[0]->get_head());
+            new_args.push_back(to_locally_nameless(args.back(), bound_var_stack));
+            bound_var_stack.pop_back();
+            return create_term(head, std::move(new_args));
+        }
+
+        for (const auto& arg : args) {
+            new_args.push_back(to_locally_nameless(arg, bound_var_stack));
+        }
+        return create_term(head, std::move(new_args));
+    }
+
+    TermPtr<int> to_locally_nameless(TermPtr<int> term) {
+        // a term without binders is its own locally nameless form
+        if (!may_contain_binder(*term)) {
+            return term;
+        }
+        vector<int> bound_var_stack;
+        return to_locally_nameless(term, bound_var_stack);
+    }
+
+    TermPtr<int> from_locally_nameless(Signature<int>& sig, TermPtr<int> term, vector<TermPtr<int>>& bound_vars) {
+        auto head = term->get_head();
+
+        if (term->is_atomic()) {
+            if (is_ln_index(head)) {
+                int i = ln_index(head);
+                if (i < bound_vars.size()) {
+                    return bound_vars[bound_vars.size() - 1 - i];
+                }
+            }
+            return term;
+        }
+
+        auto& args = term->get_args();
+        ListArgs<int> new_args;
+
+        if (_is_ln_binder(head, args.size())) {
+            auto new_bound = create_term(sig.fresh_var());
+            new_args.push_back(new_bound);
+            for (int i = 0; i < args.size() - 1; i++) {
+                new_args.push_back(from_locally_nameless(sig, args[i], bound_vars));
+            }
+            bound_vars.push_back(new_bound);
+            new_args.push_back(from_locally_nameless(sig, args.back(), bound_vars));
+            bound_vars.pop_back();
+            return create_term(head, std::move(new_args));
+        }
+
+        for (const auto& arg : args) {
+            new_args.push_back(from_locally_nameless(sig, arg, bound_vars));
+        }
+        return create_term(head, std::move(new_args));
+    }
+
+    TermPtr<int> from_locally_nameless(Signature<int>& sig, TermPtr<int> term) {
+        vector<TermPtr<int>> bound_vars;
+        return from_locally_nameless(sig, term, bound_vars);
+    }
+
+    TermPtr<int> ln_close(TermPtr<int> body, int var, int depth) {
+        auto head = body->get_head();
+
+        if (body->is_atomic()) {
+            return head == var ? create_term(ln_index(depth)) : body;
+        }
+
+        auto& args = body->get_args();
+        bool is_binder = _is_ln_binder(head, args.size());
+        ListArgs<int> new_args;
+        for (int i = 0; i < args.size(); i++) {
+            bool in_scope = is_binder && i == args.size() - 1;
+            new_args.push_back(ln_close(args[i], var, in_scope ? depth + 1 : depth));
+        }
+        return create_term(head, std::move(new_args));
+    }
+
+    TermPtr<int> ln_close(TermPtr<int> body, int var) {
+        return ln_close(body, var, 0);
+    }
+
+    TermPtr<int> ln_open(TermPtr<int> body, TermPtr<int> replacement, int depth) {
+        auto head = body->get_head();
+
+        if (body->is_atomic()) {
+            return head == ln_index(depth) ? replacement : body;
+        }
+
+        auto& args = body->get_args();
+        bool is_binder = _is_ln_binder(head, args.size());
+        ListArgs<int> new_args;
+        for (int i = 0; i < args.size(); i++) {
+            bool in_scope = is_binder && i == args.size() - 1;
+            new_args.push_back(ln_open(args[i], replacement, in_scope ? depth + 1 : depth));
+        }
+        return create_term(head, std::move(new_args));
+    }
+
+    TermPtr<int> ln_open(TermPtr<int> body, TermPtr<int> replacement) {
+        return ln_open(body, replacement, 0);
+    }
 }
\ No newline at end of file
@@ -2,35 +2,55 @@
 #include "symbols.hpp"
 #include "ualg.hpp"
 
+// Set DHAMMER_LOCALLY_NAMELESS to 0 to rename the bound variables by substituting every binder separately, instead of
+// going through the locally nameless representation, and to key the normal form cache by the terms as they are.
+#ifndef DHAMMER_LOCALLY_NAMELESS
+#define DHAMMER_LOCALLY_NAMELESS 1
+#endif
+
 namespace dhammer {
-    inline bool free_in(ualg::TermPtr<int> term, int var) {
-        auto head = term->get_head();
+    inline bool free_in(ualg::TermRef<int> term, int var) {
+        // the variable does not occur in the term at all
+        if (!term.may_contain(var)) {
+            return true;
+        }
+        auto head = term.get_head();
         if (head == var) {
             return false;
         }
-        auto& args = term->get_args();
+        auto& args = term.get_args();
         if (head == IDX || head == FORALL) {
-            auto& args = term->get_args();
             if (args[0]->get_head() == var) {
                 return true;
             }
         }
         if (head == FUN) {
-            auto& args = term->get_args();
             if (args[0]->get_head() == var) {
-                return free_in(args[1], var);
+                return free_in(*args[1], var);
             }
         }
 
         for (const auto& arg : args) {
-            if (!free_in(arg, var)) {
+            if (!free_in(*arg, var)) {
                 return false;
             }
         }
         return true;
     }
 
+    inline bool free_in(const ualg::TermPtr<int>& term, int var) {
+        return free_in(*term, var);
+    }
+
+    /**
+     * @brief Substitute the free occurrences of `var` in the term by `replacement`, renaming the bound variables that
+     * would capture the replacement. The subterms not containing `var` are shared with the original term.
+     */
     inline ualg::TermPtr<int> subst(ualg::Signature<int>& sig, ualg::TermPtr<int> term, int var, ualg::TermPtr<int> replacement) {
+        if (!term->may_contain(var)) {
+            return term;
+        }
+
         auto head = term->get_head();
 
         if (head == var) {
@@ -43,9 +63,9 @@ namespace dhammer {
             if (bound_var == var) {
                 return term;
             }
-            // rename the bound variable if it is not free in the replacement
-            if (!free_in(replacement, bound_var)) {
-                auto new_bound_var = sig.register_symbol(sig.unique_var());
+            // rename the bound variable if it is free in the replacement, and the substitution enters the body
+            if (!free_in(replacement, bound_var) && args[1]->may_contain(var)) {
+                auto new_bound_var = sig.fresh_var();
                 auto renamed_body = subst(sig, term->get_args()[1], bound_var, create_term(new_bound_var));
                 
                 return create_term(head, {create_term(new_bound_var), subst(sig, renamed_body, var, replacement)});
@@ -59,17 +79,22 @@ namespace dhammer {
                 return create_term(head, {args[0], subst(sig, args[1], var, replacement), args[2]});
             }
 
-            if (!free_in(replacement, bound_var)) {
-                auto new_bound_var = sig.register_symbol(sig.unique_var());
+            if (!free_in(replacement, bound_var) && args[2]->may_contain(var)) {
+                auto new_bound_var = sig.fresh_var();
                 auto renamed_body = subst(sig, args[2], bound_var, create_term(new_bound_var));
 
-                return create_term(head, {args[0], subst(sig, args[1], var, replacement), subst(sig, renamed_body, var, replacement)});
+                return create_term(head, {create_term(new_bound_var), subst(sig, args[1], var, replacement), subst(sig, renamed_body, var, replacement)});
             }
         }
     
         auto new_args = ualg::ListArgs<int>();
+        bool changed = false;
         for (const auto& arg : args) {
             new_args.push_back(subst(sig, arg, var, replacement));
+            changed = changed || new_args.back().get() != arg.get();
+        }
+        if (!changed) {
+            return term;
         }
         return create_term(head, std::move(new_args));
     }
@@ -83,32 +108,108 @@ namespace dhammer {
      */
     ualg::TermPtr<int> to_deBruijn(ualg::Signature<int>& sig, ualg::TermPtr<int> term);
 
-    inline bool is_eq_modulo_rset(ualg::TermPtr<int> termA, ualg::TermPtr<int> termB) {
-        if (termA->get_head() != termB->get_head()) {
+    /**
+     * @brief The locally nameless representation: the bound variables are de Bruijn indices and the free variables keep
+     * their names, so alpha equivalent terms are the same term.
+     * 
+     * The binders drop their variables: FUN(x T B) becomes FUN(T B), IDX(x B) becomes IDX(B), FORALL(x B) becomes
+     * FORALL(B) and SSUM(x S B) becomes SSUM(S B). The index i is the atomic term with the head ln_index(i), which is
+     * negative and never collides with a symbol, including the "$n" names of the fresh variables.
+     */
+    inline int ln_index(int i) {
+        return -1 - i;
+    }
+
+    inline bool is_ln_index(int head) {
+        return head < 0;
+    }
+
+    /**
+     * @brief Whether the term may contain a binder. It is decided by the head summary, so false means no binder at all.
+     */
+    inline bool may_contain_binder(ualg::TermRef<int> term) {
+        return term.may_contain(FUN) || term.may_contain(IDX) || term.may_contain(FORALL) || term.may_contain(SSUM);
+    }
+
+    /**
+     * @brief Check whether the two terms with named binders are alpha equivalent. The terms are compared in one parallel
+     * traversal without building any term, which stops at the first difference.
+     */
+    bool is_alpha_eq(ualg::TermRef<int> termA, ualg::TermRef<int> termB);
+
+    /**
+     * @brief The structural hash of the locally nameless form of the term, computed without building the form. Alpha
+     * equivalent terms have the same hash. `has_binder` is set if the term really contains a named binder.
+     */
+    std::size_t alpha_hash(ualg::TermRef<int> term, bool& has_binder);
+
+    /**
+     * @brief Transform a term with named binders to the locally nameless representation.
+     */
+    ualg::TermPtr<int> to_locally_nameless(ualg::TermPtr<int> term);
+
+    /**
+     * @brief Transform a term in the locally nameless representation back to named binders. Every binder is opened with
+     * a fresh variable, so the result satisfies the convention that all the bound variables are distinct.
+     */
+    ualg::TermPtr<int> from_locally_nameless(ualg::Signature<int>& sig, ualg::TermPtr<int> term);
+
+    /**
+     * @brief Close the locally nameless body over the free variable `var`, which becomes the index of a new binder
+     * around the body.
+     */
+    ualg::TermPtr<int> ln_close(ualg::TermPtr<int> body, int var);
+
+    /**
+     * @brief Open the locally nameless body of a binder, replacing the index of the binder by `replacement`. The
+     * replacement should be locally closed, so it needs no shifting.
+     */
+    ualg::TermPtr<int> ln_open(ualg::TermPtr<int> body, ualg::TermPtr<int> replacement);
+
+    inline bool is_eq_modulo_rset(ualg::TermRef<int> termA, ualg::TermRef<int> termB) {
+        if (&termA == &termB) {
+            return true;
+        }
+        if (termA.get_head() != termB.get_head()) {
             return false;
         }
-        auto argsA = termA->get_args();
-        auto argsB = termB->get_args();
+        auto& argsA = termA.get_args();
+        auto& argsB = termB.get_args();
 
         if (argsA.size() != argsB.size()) {
             return false;
         }
         // consider the case of RSET
-        if (termA->get_head() == RSET) {
-            std::sort(argsA.begin(), argsA.end(), [](const auto& a, const auto& b) {
-                return a->get_head() < b->get_head();
-            });
-            std::sort(argsB.begin(), argsB.end(), [](const auto& a, const auto& b) {
+        if (termA.get_head() == RSET) {
+            std::vector<const ualg::Term<int>*> sortedA;
+            std::vector<const ualg::Term<int>*> sortedB;
+            for (int i = 0; i < argsA.size(); i++) {
+                sortedA.push_back(argsA[i].get());
+                sortedB.push_back(argsB[i].get());
+            }
+            auto comp = [](const auto& a, const auto& b) {
                 return a->get_head() < b->get_head();
-            });
+            };
+            std::sort(sortedA.begin(), sortedA.end(), comp);
+            std::sort(sortedB.begin(), sortedB.end(), comp);
+            for (int i = 0; i < sortedA.size(); i++) {
+                if (!is_eq_modulo_rset(*sortedA[i], *sortedB[i])) {
+                    return false;
+                }
+            }
+            return true;
         }
         for (int i = 0; i < argsA.size(); i++) {
-            if (!is_eq_modulo_rset(argsA[i], argsB[i])) {
+            if (!is_eq_modulo_rset(*argsA[i], *argsB[i])) {
                 return false;
             }
         }
         return true;
     }
+
+    inline bool is_eq_modulo_rset(const ualg::TermPtr<int>& termA, const ualg::TermPtr<int>& termB) {
+        return is_eq_modulo_rset(*termA, *termB);
+    }
         
 
     inline bool is_eq(ualg::Signature<int>& sig, ualg::TermPtr<int> termA, ualg::TermPtr<int> termB) {
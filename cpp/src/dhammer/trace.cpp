@@ -1,5 +1,8 @@
 #include "dhammer.hpp"
 
+#include <iomanip>
+#include <sstream>
+
 namespace dhammer {
     using namespace std;
     using namespace ualg;
@@ -90,6 +93,7 @@ namespace dhammer {
         {R_ADD1, "R_ADD1"},
         {R_ADD2, "R_ADD2"},
         {R_ADD3, "R_ADD3"},
+        {R_ADD_MERGE, "R_ADD_MERGE"},
         {R_ADDK0, "R_ADDK0"},
         {R_ADDB0, "R_ADDB0"},
         {R_ADDO0, "R_ADDO0"},
@@ -240,22 +244,317 @@ namespace dhammer {
         {R_L_SORT4, "R_L_SORT4"}
     };
 
-    string record_to_string(Kernel& kernel, const PosReplaceRecord& record) {
-        string res = "";
-        res += "[Step]\t\t" + record.step + "\n";
-        res += "[Position]\t" + pos_to_string(record.pos) + "\n";
-        res += "[Initial Term]\t" + kernel.term_to_string(record.init_term) + "\n";
+    string record_to_string(Kernel& kernel, const PosReplaceRecord& record, const PrintOptions& options) {
+        ostringstream res;
+        print_record(res, kernel, record, options);
+        return res.str();
+    }
+
+    void print_record(std::ostream& os, Kernel& kernel, const PosReplaceRecord& record, const PrintOptions& options) {
+        os << "[Step]\t\t" << record.step << "\n";
+        os << "[Position]\t" << pos_to_string(record.pos) << "\n";
+        os << "[Initial Term]\t";
+        kernel.print_term(os, record.init_term, options);
+        os << "\n";
 
         // The matched term and replacement may be null
         if (record.matched_term != nullptr) {   
-            res += "[Matched Term]\t" + kernel.term_to_string(record.matched_term) + "\n";
+            os << "[Matched Term]\t";
+            kernel.print_term(os, record.matched_term, options);
+            os << "\n";
         }
         if (record.replacement != nullptr) {
-            res += "[Replacement]\t" + kernel.term_to_string(record.replacement) + "\n";
+            os << "[Replacement]\t";
+            kernel.print_term(os, record.replacement, options);
+            os << "\n";
         }
 
-        res += "[Final Term]\t" + kernel.term_to_string(record.final_term) + "\n";
+        os << "[Final Term]\t";
+        kernel.print_term(os, record.final_term, options);
+        os << "\n";
+    }
+
+    void RuleProfiler::merge(const RuleProfiler& other) {
+        for (const auto& [rule, profile] : other.profiles) {
+            auto& res = profiles[rule];
+            res.attempts += profile.attempts;
+            res.hits += profile.hits;
+            res.time += profile.time;
+        }
+    }
+
+    string RuleProfiler::to_string() const {
+        vector<pair<PosRewritingRule, RuleProfile>> sorted(profiles.begin(), profiles.end());
+        sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+            return a.second.time > b.second.time;
+        });
+
+        ostringstream res;
+        res << left << setw(24) << "Rule" << right
+            << setw(12) << "Attempts" << setw(12) << "Hits" << setw(14) << "Time (ms)" << setw(18) << "Time/Attempt (ns)" << "\n";
+
+        for (const auto& [rule, profile] : sorted) {
+            auto time_ms = chrono::duration<double, milli>(profile.time).count();
+            auto find_name = rule_name.find(rule);
+            res << left << setw(24) << (find_name != rule_name.end() ? find_name->second : "(unnamed)") << right
+                << setw(12) << profile.attempts << setw(12) << profile.hits
+                << setw(14) << fixed << setprecision(3) << time_ms
+                << setw(18) << setprecision(0) << double(profile.time.count()) / profile.attempts << "\n";
+        }
+        return res.str();
+    }
+
+    void CountSink::merge(const CountSink& other) {
+        for (const auto& [step, count] : other.counts) {
+            counts[step] += count;
+        }
+    }
+
+    string CountSink::to_string() const {
+        vector<pair<string, size_t>> sorted(counts.begin(), counts.end());
+        stable_sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+            return a.second > b.second;
+        });
+
+        ostringstream res;
+        res << left << setw(32) << "Step" << right << setw(12) << "Count" << "\n";
+        for (const auto& [step, count] : sorted) {
+            res << left << setw(32) << step << right << setw(12) << count << "\n";
+        }
+        return res.str();
+    }
+
+    static const char trace_log_magic[] = "DHTRACE1";
+
+    TraceLogWriter::TraceLogWriter(std::ostream& os, const Signature<int>& sig) : os(os), sig(sig) {
+        os.write(trace_log_magic, sizeof(trace_log_magic) - 1);
+    }
+
+    void TraceLogWriter::_write_uint(std::uint64_t value) {
+        while (value >= 0x80) {
+            os.put(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        os.put(static_cast<char>(value));
+    }
+
+    void TraceLogWriter::_write_string(std::string_view str) {
+        _write_uint(str.size());
+        os.write(str.data(), str.size());
+    }
+
+    std::uint64_t TraceLogWriter::_write_term(const TermPtr<int>& term) {
+        auto find = term_ids.find(term.get());
+        if (find != term_ids.end()) {
+            return find->second;
+        }
+
+        // the arguments are written first
+        const auto& args = term->get_args();
+        vector<std::uint64_t> arg_ids;
+        arg_ids.reserve(args.size());
+        for (const auto& arg : args) {
+            arg_ids.push_back(_write_term(arg));
+        }
+
+        auto head = term->get_head();
+        if (heads.insert(head).second) {
+            os.put('H');
+            _write_uint(head);
+            _write_string(sig.get_name(head));
+        }
+
+        os.put('T');
+        _write_uint(head);
+        _write_uint(arg_ids.size());
+        for (auto id : arg_ids) {
+            _write_uint(id);
+        }
+
+        auto id = terms.size();
+        terms.push_back(term);
+        term_ids[term.get()] = id;
+        return id;
+    }
+
+    std::uint64_t TraceLogWriter::_write_step_name(std::string_view step) {
+        auto find = step_ids.find(step);
+        if (find != step_ids.end()) {
+            return find->second;
+        }
+        os.put('N');
+        _write_string(step);
+        auto id = step_ids.size();
+        step_ids.emplace(step, id);
+        return id;
+    }
+
+    void TraceLogWriter::checkpoint() {
+        os.put('C');
+        term_ids.clear();
+        terms.clear();
+        last_term = nullptr;
+    }
+
+    void TraceLogWriter::record(PosReplaceRecord&& record) {
+        if (terms.size() >= max_terms) {
+            checkpoint();
+        }
+
+        if (record.init_term != last_term) {
+            auto init_id = _write_term(record.init_term);
+            os.put('S');
+            _write_uint(init_id);
+        }
+
+        // the steps without the matched term replace the whole term
+        bool whole = record.replacement == nullptr;
+        auto replacement_id = _write_term(whole ? record.final_term : record.replacement);
+        auto step_id = _write_step_name(record.step);
+
+        os.put('R');
+        _write_uint(step_id);
+        if (whole) {
+            _write_uint(0);
+        }
+        else {
+            _write_uint(record.pos.size());
+            for (auto i : record.pos) {
+                _write_uint(i);
+            }
+        }
+        _write_uint(replacement_id);
+        _write_uint(record.final_term->get_hash());
+
+        last_term = record.final_term;
+    }
+
+    /**
+     * @brief Read an unsigned LEB128 integer.
+     */
+    static std::uint64_t _read_uint(std::istream& is) {
+        std::uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            auto byte = is.get();
+            if (byte == std::char_traits<char>::eof()) {
+                throw runtime_error("The trace log ends in the middle of an entry.");
+            }
+            value |= std::uint64_t(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+        throw runtime_error("The trace log has a malformed integer.");
+    }
+
+    static string _read_string(std::istream& is) {
+        auto size = _read_uint(is);
+        string res(size, '\0');
+        if (!is.read(res.data(), size)) {
+            throw runtime_error("The trace log ends in the middle of an entry.");
+        }
         return res;
     }
 
+    const TermPtr<int>& TraceLogReader::_get_term(std::uint64_t id) const {
+        if (id >= terms.size() - term_base) {
+            throw runtime_error("The trace log refers to an undefined entry.");
+        }
+        return terms[term_base + id];
+    }
+
+    TraceLogReader::TraceLogReader(std::istream& is) {
+        char magic[sizeof(trace_log_magic) - 1];
+        if (!is.read(magic, sizeof(magic)) || string(magic, sizeof(magic)) != trace_log_magic) {
+            throw runtime_error("The input is not a trace log.");
+        }
+
+        std::size_t chain_start = 0;
+        while (true) {
+            auto tag = is.get();
+            if (tag == std::char_traits<char>::eof()) {
+                break;
+            }
+            switch (tag) {
+                case 'H': {
+                    auto head = static_cast<int>(_read_uint(is));
+                    head_names[head] = _read_string(is);
+                    break;
+                }
+                case 'N':
+                    step_names.push_back(_read_string(is));
+                    break;
+                case 'T': {
+                    auto head = static_cast<int>(_read_uint(is));
+                    auto arg_num = _read_uint(is);
+                    ListArgs<int> args;
+                    for (std::uint64_t i = 0; i < arg_num; i++) {
+                        args.push_back(_get_term(_read_uint(is)));
+                    }
+                    terms.push_back(arg_num == 0 ? make_term(head) : make_term(head, std::move(args)));
+                    break;
+                }
+                case 'S':
+                    chain_start = steps.size();
+                    chain_terms[chain_start] = _get_term(_read_uint(is));
+                    break;
+                case 'C':
+                    term_base = terms.size();
+                    // the next step should start a new chain
+                    chain_start = steps.size();
+                    break;
+                case 'R': {
+                    if (chain_terms.find(chain_start) == chain_terms.end()) {
+                        throw runtime_error("The trace log has a step before its initial term.");
+                    }
+                    Step step;
+                    step.step_name_id = _read_uint(is);
+                    auto pos_size = _read_uint(is);
+                    for (std::uint64_t i = 0; i < pos_size; i++) {
+                        step.pos.push_back(static_cast<unsigned int>(_read_uint(is)));
+                    }
+                    auto replacement_id = _read_uint(is);
+                    // throws if the replacement is not defined since the checkpoint
+                    _get_term(replacement_id);
+                    step.replacement_id = term_base + replacement_id;
+                    step.final_hash = _read_uint(is);
+                    step.chain_start = chain_start;
+                    if (step.step_name_id >= step_names.size()) {
+                        throw runtime_error("The trace log refers to an undefined entry.");
+                    }
+                    steps.push_back(std::move(step));
+                    break;
+                }
+                default:
+                    throw runtime_error("The trace log has an unknown entry.");
+            }
+        }
+    }
+
+    TermPtr<int> TraceLogReader::initial_term(std::size_t i) const {
+        return chain_terms.at(steps.at(i).chain_start);
+    }
+
+    TermPtr<int> TraceLogReader::term_after(std::size_t i) const {
+        auto term = initial_term(i);
+        for (auto j = steps.at(i).chain_start; j <= i; j++) {
+            term = term->replace_at(steps[j].pos, terms[steps[j].replacement_id]);
+        }
+        return term;
+    }
+
+    string TraceLogReader::term_to_string(const TermPtr<int>& term, const PrintOptions& options) const {
+        string res;
+        print_term(res, *term, [this](int head, string& res) {
+            auto find = head_names.find(head);
+            res += find != head_names.end() ? find->second : "?" + std::to_string(head);
+        }, options);
+        return res;
+    }
+
+    RuleProfiler& get_rule_profiler() {
+        thread_local RuleProfiler profiler;
+        return profiler;
+    }
+
 }; // namespace dhammer
\ No newline at end of file
@@ -2,11 +2,245 @@
 
 #include "symbols.hpp"
 
+#include <chrono>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <unordered_set>
+
 namespace dhammer {
 
     std::string pos_to_string(const ualg::TermPos& pos);
 
     extern std::map<PosRewritingRule, std::string> rule_name;
 
-    std::string record_to_string(Kernel& kernel, const PosReplaceRecord& record);
+    std::string record_to_string(Kernel& kernel, const PosReplaceRecord& record, const ualg::PrintOptions& options = {});
+
+    /**
+     * @brief Write the record to the output stream. The terms are printed with the options.
+     */
+    void print_record(std::ostream& os, Kernel& kernel, const PosReplaceRecord& record, const ualg::PrintOptions& options = {});
+
+
+    /**
+     * @brief The levels of the rewriting traces.
+     */
+    enum class TraceLevel {
+        // No trace. The rewriters make no record and no allocation for the steps.
+        OFF,
+        // The steps are only counted by their names.
+        COUNTS,
+        // Every step is streamed to the binary trace log.
+        FULL
+    };
+
+    /**
+     * @brief The sink counting the steps by their names.
+     */
+    class CountSink : public TraceSink {
+    protected:
+        std::map<std::string, std::size_t, std::less<>> counts;
+
+    public:
+        bool wants_records() const override {
+            return false;
+        }
+
+        void count(std::string_view step) override {
+            auto find = counts.find(step);
+            if (find == counts.end()) {
+                counts.emplace(step, 1);
+            }
+            else {
+                find->second++;
+            }
+        }
+
+        inline const std::map<std::string, std::size_t, std::less<>>& get_counts() const {
+            return counts;
+        }
+
+        void merge(const CountSink& other);
+
+        inline void reset() {
+            counts.clear();
+        }
+
+        /**
+         * @brief Output the table of the steps, sorted by the counts in descending order.
+         */
+        std::string to_string() const;
+    };
+
+    /**
+     * @brief The sink streaming the records to a compact binary trace log, which is replayed by TraceLogReader.
+     *
+     * The log starts with the magic string "DHTRACE1", followed by the entries. An entry is a tag byte and unsigned
+     * LEB128 integers:
+     * - 'H' head name_length name: the name of a head, before the first term with the head.
+     * - 'N' name_length name: the name of the next step name id.
+     * - 'T' head arg_num arg_ids...: the next term id. Every term is written once, after its arguments.
+     * - 'S' term_id: a new chain of steps from the term.
+     * - 'R' step_name_id pos_length pos... replacement_id final_hash: a step replacing the subterm at the position.
+     * - 'C': a checkpoint. The term ids restart from 0, and the next step starts a new chain.
+     *
+     * The steps replacing the whole term, without a matched term, are written with the empty position and their final
+     * terms as the replacements. A chain is started whenever the initial term of a step is not the final term of the
+     * previous step.
+     *
+     * The term ids count the terms written since the last checkpoint. The terms written since then are kept alive, so
+     * that their addresses identify them, and a checkpoint releases them. So the memory of the writer is bounded by
+     * max_terms, and by the terms of a command if the prover checkpoints at every command.
+     */
+    class TraceLogWriter : public TraceSink {
+    protected:
+        std::ostream& os;
+        const ualg::Signature<int>& sig;
+
+        std::unordered_map<const ualg::Term<int>*, std::uint64_t> term_ids;
+        std::vector<ualg::TermPtr<int>> terms;
+        std::unordered_set<int> heads;
+        std::map<std::string, std::uint64_t, std::less<>> step_ids;
+
+        ualg::TermPtr<int> last_term;
+
+        static constexpr std::size_t max_terms = 1 << 20;
+
+        void _write_uint(std::uint64_t value);
+        void _write_string(std::string_view str);
+        std::uint64_t _write_term(const ualg::TermPtr<int>& term);
+        std::uint64_t _write_step_name(std::string_view step);
+
+    public:
+        TraceLogWriter(std::ostream& os, const ualg::Signature<int>& sig);
+
+        bool wants_records() const override {
+            return true;
+        }
+
+        void record(PosReplaceRecord&& record) override;
+
+        /**
+         * @brief Write a checkpoint, and release the terms written before it.
+         */
+        void checkpoint();
+    };
+
+    /**
+     * @brief The reader of the binary trace log written by TraceLogWriter. The intermediate terms are reconstructed on
+     * demand, by replaying the steps from the start of their chains.
+     */
+    class TraceLogReader {
+    public:
+        struct Step {
+            std::uint64_t step_name_id;
+            ualg::TermPos pos;
+            // The index of the replacement among all the terms of the log, across the checkpoints.
+            std::uint64_t replacement_id;
+            std::size_t final_hash;
+            // The step starting the chain of this step.
+            std::size_t chain_start;
+        };
+
+    protected:
+        // The names of the heads, which keep their ids in the log.
+        std::map<int, std::string> head_names;
+        std::vector<std::string> step_names;
+        std::vector<ualg::TermPtr<int>> terms;
+        std::vector<Step> steps;
+        // The initial terms of the chains, indexed by the first steps of the chains.
+        std::map<std::size_t, ualg::TermPtr<int>> chain_terms;
+        // The index in `terms` of the term id 0 since the last checkpoint.
+        std::size_t term_base = 0;
+
+        const ualg::TermPtr<int>& _get_term(std::uint64_t id) const;
+
+    public:
+        /**
+         * @brief Read the whole log. Throw std::runtime_error if the log is malformed.
+         */
+        TraceLogReader(std::istream& is);
+
+        inline const std::vector<Step>& get_steps() const {
+            return steps;
+        }
+
+        inline const std::string& get_step_name(const Step& step) const {
+            return step_names.at(step.step_name_id);
+        }
+
+        /**
+         * @brief Return the initial term of the chain of step i.
+         */
+        ualg::TermPtr<int> initial_term(std::size_t i) const;
+
+        /**
+         * @brief Reconstruct the term after step i.
+         */
+        ualg::TermPtr<int> term_after(std::size_t i) const;
+
+        std::string term_to_string(const ualg::TermPtr<int>& term, const ualg::PrintOptions& options = {}) const;
+    };
+
+
+    /**
+     * @brief The profiling counters of a rewriting rule. The time is inclusive, i.e., it contains the nested rewritings during the rule application.
+     */
+    struct RuleProfile {
+        std::size_t attempts = 0;
+        std::size_t hits = 0;
+        std::chrono::nanoseconds time{0};
+    };
+
+    /**
+     * @brief The per-rule profiler of the rule applications in get_pos_replace. It is disabled by default.
+     * 
+     * The counters are compiled only if DHAMMER_RULE_PROFILING is set (default).
+     */
+    class RuleProfiler {
+    protected:
+        bool enabled = false;
+        std::unordered_map<PosRewritingRule, RuleProfile> profiles;
+
+    public:
+        inline bool is_enabled() const {
+            return enabled;
+        }
+
+        inline void set_enabled(bool _enabled) {
+            enabled = _enabled;
+        }
+
+        inline void record(PosRewritingRule rule, bool hit, std::chrono::nanoseconds time) {
+            auto& profile = profiles[rule];
+            profile.attempts++;
+            if (hit) {
+                profile.hits++;
+            }
+            profile.time += time;
+        }
+
+        inline void reset() {
+            profiles.clear();
+        }
+
+        /**
+         * @brief Add the profiles of another profiler, e.g., of another thread.
+         */
+        void merge(const RuleProfiler& other);
+
+        inline const std::unordered_map<PosRewritingRule, RuleProfile>& get_profiles() const {
+            return profiles;
+        }
+
+        /**
+         * @brief Output the table of the rules, sorted by the time spent in descending order.
+         */
+        std::string to_string() const;
+    };
+
+    /**
+     * @brief Get the rule profiler of the current thread.
+     */
+    RuleProfiler& get_rule_profiler();
 }; // namespace dhammer
\ No newline at end of file
@@ -1020,4 +1020,128 @@ TEST(dhammerTypeCheck, Example1) {
 
     EXPECT_TRUE(kernel.type_check(kernel.parse("c * (Tr T f) + Tr T g"), kernel.parse("STYPE")));
     
-}
\ No newline at end of file
+}
+
+TEST(dhammerTypeCheck, calc_type_cache) {
+    Kernel kernel;
+
+    kernel.assum(kernel.register_symbol("T"), kernel.parse("INDEX"));
+    kernel.assum(kernel.register_symbol("K"), kernel.parse("KTYPE[T]"));
+
+    auto term = kernel.parse("ADJ[K]");
+    auto type = kernel.calc_type(term);
+    auto& stats = kernel.get_type_cache_stats();
+
+    // the second query is answered by the cache
+    auto hits = stats.hits;
+    auto misses = stats.misses;
+    EXPECT_EQ(*kernel.calc_type(term), *type);
+    EXPECT_EQ(stats.hits, hits + 1);
+    EXPECT_EQ(stats.misses, misses);
+
+    // the same term under a different context is a different key
+    auto ctx_id = kernel.get_context_id();
+    kernel.context_push(kernel.register_symbol("x"), kernel.parse("BASIS[T]"));
+    EXPECT_NE(kernel.get_context_id(), ctx_id);
+    misses = stats.misses;
+    EXPECT_EQ(*kernel.calc_type(term), *type);
+    EXPECT_GT(stats.misses, misses);
+    kernel.context_pop();
+    EXPECT_EQ(kernel.get_context_id(), ctx_id);
+
+    // the same context gets the same id again
+    kernel.context_push(kernel.register_symbol("x"), kernel.parse("BASIS[T]"));
+    misses = stats.misses;
+    EXPECT_EQ(*kernel.calc_type(term), *type);
+    EXPECT_EQ(stats.misses, misses);
+    kernel.context_pop();
+
+    // new assumptions invalidate the cache
+    kernel.assum(kernel.register_symbol("B"), kernel.parse("BTYPE[T]"));
+    misses = stats.misses;
+    EXPECT_EQ(*kernel.calc_type(term), *type);
+    EXPECT_GT(stats.misses, misses);
+
+    // the context ids are forgotten between the commands, so that they do not grow with the fresh binders
+    auto fresh = kernel.get_sig().fresh_var();
+    kernel.context_push(fresh, kernel.parse("BASIS[T]"));
+    auto fresh_ctx_id = kernel.get_context_id();
+    kernel.context_pop();
+    kernel.reclaim_fresh_vars();
+    kernel.context_push(kernel.get_sig().fresh_var(), kernel.parse("KTYPE[T]"));
+    EXPECT_EQ(kernel.get_context_id(), fresh_ctx_id);
+    kernel.context_pop();
+}
+
+TEST(dhammerTypeCheck, nf_cache) {
+    Kernel kernel;
+
+    kernel.assum(kernel.register_symbol("T1"), kernel.parse("INDEX"));
+    kernel.assum(kernel.register_symbol("T2"), kernel.parse("INDEX"));
+
+    auto& stats = kernel.get_nf_cache_stats();
+
+    // identical terms need no normalization
+    EXPECT_TRUE(kernel.is_judgemental_eq(kernel.parse("PROD[T1, T2]"), kernel.parse("PROD[T1, T2]")));
+    EXPECT_EQ(stats.misses, 0);
+
+#if DHAMMER_LOCALLY_NAMELESS
+    // alpha equivalent terms are normalized once, and share the cache entry of their locally nameless form
+    EXPECT_TRUE(kernel.is_judgemental_eq(kernel.parse("idx T => BASIS[T]"), kernel.parse("idx S => BASIS[S]")));
+    EXPECT_EQ(stats.misses, 1);
+    EXPECT_EQ(stats.hits, 1);
+
+    EXPECT_FALSE(kernel.is_judgemental_eq(kernel.parse("idx T => BASIS[T]"), kernel.parse("idx S => BASIS[T1]")));
+    EXPECT_EQ(stats.misses, 2);
+    EXPECT_EQ(stats.hits, 2);
+
+    EXPECT_FALSE(kernel.is_judgemental_eq(kernel.parse("idx S => BASIS[S]"), kernel.parse("idx T => BASIS[T1]")));
+    EXPECT_EQ(stats.misses, 2);
+    EXPECT_EQ(stats.hits, 4);
+
+    // new assumptions invalidate the cache
+    kernel.assum(kernel.register_symbol("T3"), kernel.parse("INDEX"));
+    auto misses = stats.misses;
+    EXPECT_FALSE(kernel.is_judgemental_eq(kernel.parse("idx T => BASIS[T]"), kernel.parse("idx S => BASIS[T1]")));
+    EXPECT_EQ(stats.misses, misses + 2);
+#else
+    EXPECT_TRUE(kernel.is_judgemental_eq(kernel.parse("idx T => BASIS[T]"), kernel.parse("idx S => BASIS[S]")));
+    EXPECT_EQ(stats.misses, 2);
+    EXPECT_TRUE(kernel.is_judgemental_eq(kernel.parse("idx T => BASIS[T]"), kernel.parse("idx S => BASIS[S]")));
+    EXPECT_EQ(stats.misses, 2);
+    EXPECT_EQ(stats.hits, 2);
+    EXPECT_FALSE(kernel.is_judgemental_eq(kernel.parse("idx T => BASIS[T]"), kernel.parse("idx S => BASIS[T1]")));
+
+    // new assumptions invalidate the cache
+    kernel.assum(kernel.register_symbol("T3"), kernel.parse("INDEX"));
+    auto misses = stats.misses;
+    EXPECT_TRUE(kernel.is_judgemental_eq(kernel.parse("idx T => BASIS[T]"), kernel.parse("idx S => BASIS[S]")));
+    EXPECT_EQ(stats.misses, misses + 2);
+#endif
+}
+
+TEST(dhammerTypeCheck, find_dec_shadowing) {
+    Kernel kernel;
+
+    auto T = kernel.register_symbol("T");
+    auto x = kernel.register_symbol("x");
+    kernel.assum(T, kernel.parse("INDEX"));
+    kernel.assum(x, kernel.parse("BASIS[T]"));
+
+    EXPECT_EQ(kernel.find_in_env(kernel.register_symbol("y")), nullptr);
+    EXPECT_EQ(*kernel.find_dec(x)->type, *kernel.parse("BASIS[T]"));
+
+    kernel.context_push(x, kernel.parse("KTYPE[T]"));
+    kernel.context_push(x, kernel.parse("BTYPE[T]"));
+    EXPECT_EQ(*kernel.find_dec(x)->type, *kernel.parse("BTYPE[T]"));
+    EXPECT_EQ(*kernel.find_in_env(x)->type, *kernel.parse("BASIS[T]"));
+
+    kernel.context_pop();
+    EXPECT_EQ(*kernel.find_dec(x)->type, *kernel.parse("KTYPE[T]"));
+    kernel.context_pop();
+    EXPECT_EQ(*kernel.find_dec(x)->type, *kernel.parse("BASIS[T]"));
+
+    kernel.env_pop();
+    EXPECT_EQ(kernel.find_dec(x), nullptr);
+    EXPECT_NE(kernel.find_dec(T), nullptr);
+}
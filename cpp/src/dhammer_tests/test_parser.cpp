@@ -70,6 +70,12 @@ TEST(dhammerParser, CheckEq) {
     EXPECT_EQ(actual_res, expected_res);
 }
 
+TEST(dhammerParser, Profile) {
+    auto actual_res = parse("Profile on. Profile. Profile reset.");
+    auto expected_res = astparser::parse("GROUP[PROFILE[on], PROFILE, PROFILE[reset]]");
+    EXPECT_EQ(actual_res, expected_res);
+}
+
 
 ////////////////////////////////////////////////////
 // term
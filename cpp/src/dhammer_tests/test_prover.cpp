@@ -50,4 +50,150 @@ TEST(dhammerProver, CheckEq2) {
         CheckEq a b K with (a*b).K.
         )")
     );
-}
\ No newline at end of file
+}
+
+TEST(dhammerProver, CheckEqConcurrent) {
+    Prover prover;
+    prover.set_concurrent_check_eq(true);
+    EXPECT_TRUE(prover.process(R"(
+        Var a : STYPE. 
+        Var b : STYPE. 
+        Var T : INDEX. 
+        Var K : KTYPE[T].
+        Def f := fun x : BASIS[T] => <x| K.
+        )")
+    );
+    EXPECT_TRUE(prover.check_eq("a b K", "(a*b).K"));
+    EXPECT_TRUE(prover.check_eq("Sum i in USET[T], f i", "Sum j in USET[T], <j| K"));
+    EXPECT_FALSE(prover.check_eq("a K", "b K"));
+
+    // the worker kernel follows the later definitions and the new symbols
+    EXPECT_TRUE(prover.process("Def g := fun y : BASIS[T] => <y| K."));
+    EXPECT_TRUE(prover.check_eq("Sum k in USET[T], g k", "Sum l in USET[T], f l"));
+    EXPECT_TRUE(prover.check_eq("Sum k in USET[T], f k", "Sum m in USET[T], <m| K"));
+}
+
+TEST(dhammerProver, FreshVarReclaim) {
+    Prover prover;
+    EXPECT_TRUE(prover.process(R"(
+        Var T : INDEX. 
+        Var K : KTYPE[T].
+        Def f := fun x : BASIS[T] => <x| K.
+        )")
+    );
+    auto& sig = prover.get_kernel().get_sig();
+
+    EXPECT_TRUE(prover.check_eq("Sum i in USET[T], f i", "Sum j in USET[T], <j| K"));
+    auto symbol_num = sig.get_symbol_num();
+    auto mark = sig.get_fresh_var_mark();
+
+    // the fresh variables of the previous command are reused, and the signature does not grow
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(prover.check_eq("Sum i in USET[T], f i", "Sum j in USET[T], <j| K"));
+        EXPECT_EQ(sig.get_fresh_var_mark(), mark);
+    }
+    EXPECT_EQ(sig.get_symbol_num(), symbol_num);
+}
+
+TEST(dhammerProver, Profile) {
+    Prover prover;
+    EXPECT_TRUE(prover.process(R"(
+        Profile on.
+        Var a : STYPE. 
+        Var b : STYPE. 
+        Var T : INDEX. 
+        Var K : KTYPE[T].
+        CheckEq a b K with (a*b).K.
+        Profile.
+        )")
+    );
+
+    auto& profiler = get_rule_profiler();
+#if DHAMMER_RULE_PROFILING
+    EXPECT_FALSE(profiler.get_profiles().empty());
+    std::size_t hits = 0;
+    for (const auto& [rule, profile] : profiler.get_profiles()) {
+        EXPECT_LE(profile.hits, profile.attempts);
+        hits += profile.hits;
+    }
+    EXPECT_GT(hits, 0);
+#endif
+
+    EXPECT_TRUE(prover.process("Profile reset. Profile off."));
+    EXPECT_TRUE(profiler.get_profiles().empty());
+    EXPECT_FALSE(profiler.is_enabled());
+    EXPECT_FALSE(prover.process("Profile start."));
+}
+
+TEST(dhammerProver, ProfileConcurrent) {
+    auto profile_hits = [](bool concurrent) {
+        Prover prover;
+        prover.set_concurrent_check_eq(concurrent);
+        EXPECT_TRUE(prover.process(R"(
+            Profile reset.
+            Profile on.
+            Var a : STYPE. 
+            Var b : STYPE. 
+            Var T : INDEX. 
+            Var K : KTYPE[T].
+            CheckEq a b K with (a*b).K.
+            Profile off.
+            )")
+        );
+        std::size_t hits = 0;
+        for (const auto& [rule, profile] : get_rule_profiler().get_profiles()) {
+            hits += profile.hits;
+        }
+        get_rule_profiler().reset();
+        return hits;
+    };
+
+    // the rules applied to the second side in the worker thread are profiled too
+    auto sequential_hits = profile_hits(false);
+    EXPECT_EQ(profile_hits(true), sequential_hits);
+#if DHAMMER_RULE_PROFILING
+    EXPECT_GT(sequential_hits, 0);
+#endif
+}
+
+TEST(dhammerProver, TraceLevel) {
+    stringstream output;
+    Prover prover(nullptr, output);
+    EXPECT_TRUE(prover.process(R"(
+        Var a : STYPE. 
+        Var b : STYPE. 
+        Var T : INDEX. 
+        Var K : KTYPE[T].
+        )")
+    );
+
+    prover.set_trace_level(TraceLevel::COUNTS);
+    EXPECT_TRUE(prover.check_eq("a b K", "(a*b).K"));
+    EXPECT_FALSE(prover.get_trace_counts().get_counts().empty());
+
+    // the log is replayed to the normal form of the last term
+    string log_path = "test_prover_trace.dhtrace";
+    prover.set_trace_level(TraceLevel::FULL, log_path);
+    EXPECT_TRUE(prover.process("Normalize (a*b).K. Normalize a b K."));
+    prover.set_trace_level(TraceLevel::OFF);
+
+    ifstream file(log_path, ios::binary);
+    TraceLogReader reader(file);
+    const auto& steps = reader.get_steps();
+    ASSERT_FALSE(steps.empty());
+    // the passes continue from each other, so every normalization is one chain of steps, after the checkpoint of its
+    // command
+    set<size_t> chain_starts;
+    for (const auto& step : steps) {
+        chain_starts.insert(step.chain_start);
+    }
+    EXPECT_EQ(chain_starts.size(), 2);
+    for (size_t i = 0; i < steps.size(); i++) {
+        EXPECT_EQ(reader.term_after(i)->get_hash(), steps[i].final_hash);
+    }
+    EXPECT_NE(output.str().find(reader.term_to_string(reader.term_after(steps.size() - 1))), string::npos);
+    file.close();
+    remove(log_path.c_str());
+
+    EXPECT_THROW(prover.set_trace_level(TraceLevel::FULL), std::runtime_error);
+}
@@ -15,7 +15,7 @@ TEST(dhammerReduction, variable_expand_K) {
 
     auto term = kernel.parse("K");
     auto actual_res = variable_expand(kernel, term);
-    auto expected_res = kernel.parse("SUM[USET[A], FUN[$0, BASIS[A], SCR[DOT[BRA[$0], K], KET[$0]]]]");
+    auto expected_res = kernel.parse("SUM[USET[A], FUN[$v0, BASIS[A], SCR[DOT[BRA[$v0], K], KET[$v0]]]]");
 
     EXPECT_EQ(*actual_res, *expected_res);
 }
@@ -29,7 +29,7 @@ TEST(dhammerReduction, variable_expand_K_apply) {
 
     auto term = kernel.parse("APPLY[fK, a]");
     auto actual_res = variable_expand(kernel, term);
-    auto expected_res = kernel.parse("SUM[USET[A], FUN[$0, BASIS[A], SCR[DOT[BRA[$0], APPLY[fK, a]], KET[$0]]]]");
+    auto expected_res = kernel.parse("SUM[USET[A], FUN[$v0, BASIS[A], SCR[DOT[BRA[$v0], APPLY[fK, a]], KET[$v0]]]]");
 
     EXPECT_EQ(*actual_res, *expected_res);
 }
@@ -41,7 +41,7 @@ TEST(dhammerReduction, variable_expand_B) {
 
     auto term = kernel.parse("B");
     auto actual_res = variable_expand(kernel, term);
-    auto expected_res = kernel.parse("SUM[USET[A], FUN[$0, BASIS[A], SCR[DOT[B, KET[$0]], BRA[$0]]]]");
+    auto expected_res = kernel.parse("SUM[USET[A], FUN[$v0, BASIS[A], SCR[DOT[B, KET[$v0]], BRA[$v0]]]]");
 
     EXPECT_EQ(*actual_res, *expected_res);
 }
@@ -55,12 +55,113 @@ TEST(dhammerReduction, variable_expand_O) {
 
     auto term = kernel.parse("O");
     auto actual_res = variable_expand(kernel, term);
-    auto expected_res = kernel.parse("SUM[USET[A], FUN[$0, BASIS[A], SUM[USET[B], FUN[$1, BASIS[B], SCR[DOT[BRA[$0], MULK[O, KET[$1]]], OUTER[KET[$0], BRA[$1]]]]]]]");
+    auto expected_res = kernel.parse("SUM[USET[A], FUN[$v0, BASIS[A], SUM[USET[B], FUN[$v1, BASIS[B], SCR[DOT[BRA[$v0], MULK[O, KET[$v1]]], OUTER[KET[$v0], BRA[$v1]]]]]]]");
 
     EXPECT_EQ(*actual_res, *expected_res);
 }
 
 
+TEST(dhammerReduction, rule_set_index) {
+    RuleSet rule_set = {R_DELTA, R_DOT6, R_DOT3, R_DOT2, R_DOT0, R_SCR1};
+
+    Kernel kernel;
+    kernel.register_symbol("a");
+    kernel.register_symbol("b");
+
+    auto get_candidates = [&](const string& code) {
+        vector<PosRewritingRule> res;
+        auto candidates = rule_set.get_candidates(*kernel.parse(code));
+        while (auto rule = candidates.next()) {
+            res.push_back(rule);
+        }
+        return res;
+    };
+
+    // the candidates match the argument heads, and keep the order of the rule list
+    EXPECT_EQ(get_candidates("DOT[BRA[a], KET[b]]"), (vector<PosRewritingRule>{R_DELTA, R_DOT6, R_DOT0}));
+    EXPECT_EQ(get_candidates("DOT[SCR[a, b], SCR[a, b]]"), (vector<PosRewritingRule>{R_DELTA, R_DOT3, R_DOT2, R_DOT0}));
+    EXPECT_EQ(get_candidates("DOT[a, SCR[a, b]]"), (vector<PosRewritingRule>{R_DELTA, R_DOT3, R_DOT0}));
+    EXPECT_EQ(get_candidates("SCR[a, b]"), (vector<PosRewritingRule>{R_DELTA}));
+    EXPECT_EQ(get_candidates("a"), (vector<PosRewritingRule>{R_DELTA}));
+}
+
+
+TEST(dhammerReduction, pos_rewrite_repeated_trace) {
+    Kernel kernel;
+    kernel.assum(kernel.register_symbol("T"), kernel.parse("INDEX"));
+    kernel.assum(kernel.register_symbol("K"), kernel.parse("KTYPE[T]"));
+    kernel.assum(kernel.register_symbol("B"), kernel.parse("BTYPE[T]"));
+    kernel.assum(kernel.register_symbol("a"), kernel.parse("STYPE"));
+
+    auto term = kernel.parse("ADJ[ADD[SCR[a, K], SCR[1, K], OUTER[K, ADJ[ADJ[B]]]]]");
+
+    // the reference: search from the root without any record after each step
+    vector<string> expected_steps;
+    auto current_term = term;
+    while (true) {
+        auto replace_res = get_pos_replace(kernel, current_term, rules);
+        if (!replace_res.has_value()) break;
+        expected_steps.push_back(replace_res->step + pos_to_string(replace_res->pos));
+        current_term = current_term->replace_at(replace_res->pos, replace_res->replacement);
+    }
+
+    vector<PosReplaceRecord> trace;
+    auto actual_res = pos_rewrite_repeated(kernel, term, rules, &trace);
+
+    vector<string> actual_steps;
+    for (const auto& record : trace) {
+        actual_steps.push_back(record.step + pos_to_string(record.pos));
+    }
+
+    EXPECT_EQ(actual_steps, expected_steps);
+    EXPECT_EQ(actual_res, current_term);
+}
+
+TEST(dhammerReduction, pos_rewrite_repeated_strategies) {
+    Kernel kernel;
+    kernel.assum(kernel.register_symbol("T"), kernel.parse("INDEX"));
+    kernel.assum(kernel.register_symbol("K"), kernel.parse("KTYPE[T]"));
+    kernel.assum(kernel.register_symbol("B"), kernel.parse("BTYPE[T]"));
+    kernel.assum(kernel.register_symbol("a"), kernel.parse("STYPE"));
+
+    auto term = kernel.parse("ADJ[ADD[SCR[a, K], SCR[1, K], OUTER[K, ADJ[ADJ[B]]]]]");
+    auto expected_res = pos_rewrite_repeated(kernel, term, rules);
+
+    for (auto strategy : {RewriteStrategy::INNERMOST, RewriteStrategy::PARALLEL_OUTERMOST}) {
+        vector<PosReplaceRecord> trace;
+        auto actual_res = pos_rewrite_repeated(kernel, term, rules, &trace, strategy);
+        EXPECT_EQ(actual_res, expected_res);
+
+        // the trace is a chain of steps from the term to the result
+        auto current_term = term;
+        for (const auto& record : trace) {
+            EXPECT_EQ(record.init_term, current_term);
+            EXPECT_EQ(current_term->replace_at(record.pos, record.replacement), record.final_term);
+            current_term = record.final_term;
+        }
+        EXPECT_EQ(current_term, actual_res);
+    }
+}
+
+TEST(dhammerReduction, innermost_memo) {
+    Kernel kernel;
+    kernel.assum(kernel.register_symbol("T"), kernel.parse("INDEX"));
+    kernel.assum(kernel.register_symbol("K"), kernel.parse("KTYPE[T]"));
+    kernel.assum(kernel.register_symbol("a"), kernel.parse("STYPE"));
+
+    // the shared subterm is normalized once, and the reuse is not a rewriting step
+    auto term = kernel.parse("ADD[SCR[a, SCR[1, K]], OUTER[SCR[a, SCR[1, K]], ADJ[K]]]");
+    auto& stats = kernel.get_innermost_memo_stats();
+    auto hits = stats.hits;
+
+    CountSink counts;
+    auto res = pos_rewrite_repeated(kernel, term, rules, &counts, RewriteStrategy::INNERMOST);
+    EXPECT_EQ(res, pos_rewrite_repeated(kernel, term, rules));
+    EXPECT_GT(stats.hits, hits);
+    EXPECT_EQ(counts.get_counts().count("Reuse Normal Form"), 0);
+}
+
+
 TEST(dhammerReduction, wolfram_fullsimplify) {
     auto [ep, lp] = wstp::init_and_openlink(wstp::MACOS_ARGC, wstp::MACOS_ARGV);
     Kernel kernel(lp);
@@ -555,6 +656,31 @@ TEST(dhammerReduction, R_ADD3) {
     TEST_RULE({R_ADD3}, "ADD[SCR[b, X], Y, Z, SCR[a, X], W]", "ADD[Y, Z, W, SCR[Plus[b, a], X]]");
 }
 
+TEST(dhammerReduction, R_ADD_MERGE) {
+    TEST_RULE({R_ADD_MERGE}, "ADD[X, X, Y, Z]", "ADD[Y, Z, SCR[Plus[1, 1], X]]");
+    TEST_RULE({R_ADD_MERGE}, "ADD[SCR[a, X], Y, X, Z, SCR[b, Y], SCR[c, X], W]", "ADD[Z, W, SCR[Plus[a, 1, c], X], SCR[Plus[1, b], Y]]");
+    TEST_RULE({R_ADD_MERGE}, "ADD[X, Y]", "ADD[X, Y]");
+    // The like terms are compared modulo the names of the bound variables
+    TEST_RULE({R_ADD_MERGE},
+        "ADD[FUN[i, BASIS[T], KET[i]], Y, SCR[a, FUN[j, BASIS[T], KET[j]]]]",
+        "ADD[Y, SCR[Plus[1, a], FUN[i, BASIS[T], KET[i]]]]");
+    // but the sums are left to R_SUM_FACTOR
+    TEST_RULE({R_ADD_MERGE},
+        "ADD[SUM[M, FUN[i, BASIS[T], KET[i]]], SUM[M, FUN[j, BASIS[T], KET[j]]]]",
+        "ADD[SUM[M, FUN[i, BASIS[T], KET[i]]], SUM[M, FUN[j, BASIS[T], KET[j]]]]");
+}
+
+TEST(dhammerReduction, R_SUM_FACTOR) {
+    TEST_RULE({R_SUM_FACTOR}, "ADD[SCR[a, X], Y, X]", "ADD[Y, SCR[Plus[a, 1], X]]");
+    TEST_RULE({R_SUM_FACTOR},
+        "ADD[SUM[USET[T], FUN[i, BASIS[T], SCR[DOT[BRA[i], K], KET[i]]]], Y, SUM[USET[T], FUN[j, BASIS[T], KET[j]]]]",
+        "ADD[Y, SUM[USET[T], FUN[i, BASIS[T], SCR[Plus[DOT[BRA[i], K], 1], KET[i]]]]]");
+    // Sums over different sets are not merged
+    TEST_RULE({R_SUM_FACTOR},
+        "ADD[SUM[M, FUN[i, BASIS[T], KET[i]]], SUM[N, FUN[j, BASIS[T], KET[j]]]]",
+        "ADD[SUM[M, FUN[i, BASIS[T], KET[i]]], SUM[N, FUN[j, BASIS[T], KET[j]]]]");
+}
+
 TEST(dhammerReduction, R_ADDK0) {
     TEST_RULE({R_ADDK0}, "ADD[K1, K2, 0K[T], K3]", "ADD[K1, K2, K3]");
 }
@@ -924,7 +1050,7 @@ TEST(dhammerReduction, R_SUM_CONST3) {
 }
 
 TEST(dhammerReduction, R_SUM_CONST4) {
-    TEST_RULE({R_SUM_CONST4}, "1O[T]", "SUM[USET[T], FUN[$0, BASIS[T], OUTER[KET[$0], BRA[$0]]]]");
+    TEST_RULE({R_SUM_CONST4}, "1O[T]", "SUM[USET[T], FUN[$v0, BASIS[T], OUTER[KET[$v0], BRA[$v0]]]]");
 }
 
 TEST(dhammerReduction, R_SUM_ELIM0) {
@@ -1239,28 +1365,28 @@ TEST(dhammerReduction, R_SUM_PUSH16) {
 }
 
 TEST(dhammerReduction, R_SUM_ADDS0) {
-    TEST_RULE({R_SUM_ADDS0}, "SUM[M, FUN[i, T, Plus[a, b]]]", "Plus[SUM[M, FUN[$0, T, a]], SUM[M, FUN[$1, T, b]]]");
+    TEST_RULE({R_SUM_ADDS0}, "SUM[M, FUN[i, T, Plus[a, b]]]", "Plus[SUM[M, FUN[$v0, T, a]], SUM[M, FUN[$v1, T, b]]]");
 }
 
 TEST(dhammerReduction, R_SUM_ADDS1) {
     TEST_RULE({R_SUM_ADDS1}, "SUM[M, FUN[i, T, Times[x, Plus[a, b, c]]]]", 
-    "Plus[SUM[M, FUN[$0, T, Times[x, a]]], SUM[M, FUN[$1, T, Times[x, b]]], SUM[M, FUN[$2, T, Times[x, c]]]]");
+    "Plus[SUM[M, FUN[$v0, T, Times[x, a]]], SUM[M, FUN[$v1, T, Times[x, b]]], SUM[M, FUN[$v2, T, Times[x, c]]]]");
 }
 
 TEST(dhammerReduction, R_SUM_ADD0) {
-    TEST_RULE({R_SUM_ADD0}, "SUM[M, FUN[i, T, ADD[X, Y]]]", "ADD[SUM[M, FUN[$0, T, X]], SUM[M, FUN[$1, T, Y]]]");
+    TEST_RULE({R_SUM_ADD0}, "SUM[M, FUN[i, T, ADD[X, Y]]]", "ADD[SUM[M, FUN[$v0, T, X]], SUM[M, FUN[$v1, T, Y]]]");
 }
 
 TEST(dhammerReduction, R_SUM_ADD1) {
-    TEST_RULE({R_SUM_ADD1}, "SUM[M, FUN[i, T, SCR[Plus[a, b, c], KET[i]]]]", "ADD[SUM[M, FUN[$0, T, SCR[a, KET[$0]]]], SUM[M, FUN[$1, T, SCR[b, KET[$1]]]], SUM[M, FUN[$2, T, SCR[c, KET[$2]]]]]");
+    TEST_RULE({R_SUM_ADD1}, "SUM[M, FUN[i, T, SCR[Plus[a, b, c], KET[i]]]]", "ADD[SUM[M, FUN[$v0, T, SCR[a, KET[$v0]]]], SUM[M, FUN[$v1, T, SCR[b, KET[$v1]]]], SUM[M, FUN[$v2, T, SCR[c, KET[$v2]]]]]");
 }
 
 TEST(dhammerReduction, R_SUM_INDEX0) {
-    TEST_RULE({R_SUM_INDEX0}, "SUM[USET[PROD[T1, T2]], FUN[i, BASIS[PROD[T1, T2]], X]]", "SUM[USET[T1], FUN[$0, BASIS[T1], SUM[USET[T2], FUN[$1, BASIS[T2], X]]]]");
+    TEST_RULE({R_SUM_INDEX0}, "SUM[USET[PROD[T1, T2]], FUN[i, BASIS[PROD[T1, T2]], X]]", "SUM[USET[T1], FUN[$v0, BASIS[T1], SUM[USET[T2], FUN[$v1, BASIS[T2], X]]]]");
 }
 
 TEST(dhammerReduction, R_SUM_INDEX1) {
-    TEST_RULE({R_SUM_INDEX1}, "SUM[CATPROD[M1, M2], FUN[i, BASIS[PROD[T1, T2]], X]]", "SUM[M1, FUN[$0, BASIS[T1], SUM[M2, FUN[$1, BASIS[T2], X]]]]");
+    TEST_RULE({R_SUM_INDEX1}, "SUM[CATPROD[M1, M2], FUN[i, BASIS[PROD[T1, T2]], X]]", "SUM[M1, FUN[$v0, BASIS[T1], SUM[M2, FUN[$v1, BASIS[T2], X]]]]");
 }
 
 TEST(dhammerReduction, R_BIT_ONEO) {
@@ -1278,7 +1404,7 @@ TEST(dhammerReduction, R_LABEL_EXPAND_K) {
     kernel.assum(kernel.register_symbol("r"), kernel.parse("REG[T1]"));
     kernel.assum(kernel.register_symbol("K"), kernel.parse("KTYPE[T1]"));
 
-    TEST_RULE(kernel, {R_LABEL_EXPAND}, "SUBS[K, r]", "SUM[USET[T1], FUN[$0, BASIS[T1], SCR[DOT[BRA[$0], K], LTSR[LKET[$0, r]]]]]");
+    TEST_RULE(kernel, {R_LABEL_EXPAND}, "SUBS[K, r]", "SUM[USET[T1], FUN[$v0, BASIS[T1], SCR[DOT[BRA[$v0], K], LTSR[LKET[$v0, r]]]]]");
 }
 
 
@@ -1289,7 +1415,7 @@ TEST(dhammerReduction, R_LABEL_EXPAND_B) {
     kernel.assum(kernel.register_symbol("r"), kernel.parse("REG[T1]"));
     kernel.assum(kernel.register_symbol("B"), kernel.parse("BTYPE[T1]"));
 
-    TEST_RULE(kernel, {R_LABEL_EXPAND}, "SUBS[B, r]", "SUM[USET[T1], FUN[$0, BASIS[T1], SCR[DOT[B, KET[$0]], LTSR[LBRA[$0, r]]]]]");
+    TEST_RULE(kernel, {R_LABEL_EXPAND}, "SUBS[B, r]", "SUM[USET[T1], FUN[$v0, BASIS[T1], SCR[DOT[B, KET[$v0]], LTSR[LBRA[$v0, r]]]]]");
 }
 
 
@@ -1301,7 +1427,7 @@ TEST(dhammerReduction, R_LABEL_EXPAND_O) {
     kernel.assum(kernel.register_symbol("r"), kernel.parse("REG[T1]"));
     kernel.assum(kernel.register_symbol("O"), kernel.parse("OTYPE[T1, T1]"));
 
-    TEST_RULE(kernel, {R_LABEL_EXPAND}, "SUBS[O, r, r]", "SUM[USET[T1], FUN[$0, BASIS[T1], SUM[USET[T1], FUN[$1, BASIS[T1], SCR[DOT[BRA[$0], MULK[O, KET[$1]]], LDOT[LTSR[LKET[$0, r]], LTSR[LBRA[$1, r]]]]]]]]");
+    TEST_RULE(kernel, {R_LABEL_EXPAND}, "SUBS[O, r, r]", "SUM[USET[T1], FUN[$v0, BASIS[T1], SUM[USET[T1], FUN[$v1, BASIS[T1], SCR[DOT[BRA[$v0], MULK[O, KET[$v1]]], LDOT[LTSR[LKET[$v0, r]], LTSR[LBRA[$v1, r]]]]]]]]");
 }
 
 TEST(dhammerReduction, R_ADJD0) {
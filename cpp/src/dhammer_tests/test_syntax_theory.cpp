@@ -59,11 +59,32 @@ TEST(dhammerSyntaxTheory, Substitution2) {
     auto var = sig.parse("T")->get_head();
     
     auto actual_res = subst(sig, initial_term, var, sig.parse("APPLY[x, x]"));
-    auto expected_res = sig.parse("IDX[$0, APPLY[x, x]]]");
+    auto expected_res = sig.parse("IDX[$v0, APPLY[x, x]]]");
 
     EXPECT_EQ(*actual_res, *expected_res);
 }
 
+TEST(dhammerSyntaxTheory, FreshVar) {
+    auto sig = dhammer_sig;
+    auto symbol_num = sig.get_symbol_num();
+
+    auto mark = sig.get_fresh_var_mark();
+    auto a = sig.fresh_var();
+    auto b = sig.fresh_var();
+    EXPECT_NE(a, b);
+    EXPECT_TRUE(sig.is_fresh_var(a));
+    EXPECT_FALSE(sig.is_fresh_var(sig.get_repr("FUN")));
+    EXPECT_EQ(sig.get_symbol_num(), symbol_num);
+
+    // the fresh variables are named lazily, and the names are parsed back to them
+    auto term = create_term(FUN, {create_term(a), sig.parse("T"), create_term(b)});
+    EXPECT_EQ(*sig.parse(sig.term_to_string(term)), *term);
+    EXPECT_EQ(sig.get_symbol_num(), symbol_num + 1);
+
+    sig.reclaim_fresh_vars(mark);
+    EXPECT_EQ(sig.fresh_var(), a);
+}
+
 TEST(dhammerSyntaxTheory, Substitution3) {
     auto sig = dhammer_sig;
 
@@ -94,4 +115,116 @@ TEST(dhammerSyntaxTheory, to_deBruijn2) {
     auto expected_res = sig.parse("FUN[KTYPE[x], APPLY[$0, FUN[T, APPLY[$0, $1]]]]");
 
     EXPECT_EQ(*actual_res, *expected_res);
-}
\ No newline at end of file
+}
+TEST(dhammerSyntaxTheory, locally_nameless1) {
+    auto sig = dhammer_sig;
+
+    // alpha equivalent terms are the same term
+    auto termA = to_locally_nameless(sig.parse("FUN[x, KTYPE[x], APPLY[x, FUN[y, T, APPLY[y, x]]]]"));
+    auto termB = to_locally_nameless(sig.parse("FUN[z, KTYPE[x], APPLY[z, FUN[w, T, APPLY[w, z]]]]"));
+    EXPECT_EQ(*termA, *termB);
+
+    auto termC = to_locally_nameless(sig.parse("SSUM[i, M, APPLY[i, j]]"));
+    auto termD = to_locally_nameless(sig.parse("SSUM[k, M, APPLY[k, j]]"));
+    auto termE = to_locally_nameless(sig.parse("SSUM[k, M, APPLY[j, k]]"));
+    EXPECT_EQ(*termC, *termD);
+    EXPECT_NE(*termC, *termE);
+}
+
+TEST(dhammerSyntaxTheory, alpha_eq) {
+    auto sig = dhammer_sig;
+
+    EXPECT_TRUE(is_alpha_eq(*sig.parse("FUN[x, KTYPE[x], APPLY[x, FUN[y, T, APPLY[y, x]]]]"), *sig.parse("FUN[z, KTYPE[x], APPLY[z, FUN[w, T, APPLY[w, z]]]]")));
+    EXPECT_TRUE(is_alpha_eq(*sig.parse("SSUM[i, M, APPLY[i, j]]"), *sig.parse("SSUM[k, M, APPLY[k, j]]")));
+    EXPECT_FALSE(is_alpha_eq(*sig.parse("SSUM[i, M, APPLY[i, j]]"), *sig.parse("SSUM[k, M, APPLY[j, k]]")));
+    // the shared subterm refers to different binders
+    EXPECT_FALSE(is_alpha_eq(*sig.parse("FUN[i, T, FUN[j, T, i]]"), *sig.parse("FUN[j, T, FUN[i, T, i]]")));
+    // the free variable is not captured
+    EXPECT_FALSE(is_alpha_eq(*sig.parse("IDX[i, APPLY[i, j]]"), *sig.parse("IDX[j, APPLY[j, j]]")));
+}
+
+TEST(dhammerSyntaxTheory, alpha_hash) {
+    auto sig = dhammer_sig;
+
+    // the hash of the locally nameless form, without building it
+    for (auto code : {"FUN[x, KTYPE[x], APPLY[x, FUN[y, T, APPLY[y, x]]]]", "SSUM[i, M, APPLY[i, j]]", "APPLY[a, b]"}) {
+        auto term = sig.parse(code);
+        bool has_binder = false;
+        EXPECT_EQ(alpha_hash(*term, has_binder), to_locally_nameless(term)->get_hash());
+    }
+
+    bool has_binderA = false;
+    bool has_binderB = false;
+    EXPECT_EQ(alpha_hash(*sig.parse("FUN[x, KTYPE[x], APPLY[x, FUN[y, T, APPLY[y, x]]]]"), has_binderA),
+              alpha_hash(*sig.parse("FUN[z, KTYPE[x], APPLY[z, FUN[w, T, APPLY[w, z]]]]"), has_binderB));
+    EXPECT_TRUE(has_binderA);
+    EXPECT_TRUE(has_binderB);
+
+    bool has_binder = false;
+    alpha_hash(*sig.parse("APPLY[a, b]"), has_binder);
+    EXPECT_FALSE(has_binder);
+}
+
+TEST(dhammerSyntaxTheory, locally_nameless2) {
+    auto sig = dhammer_sig;
+
+    // the round trip gives fresh bound variables
+    auto term = sig.parse("FUN[x, KTYPE[x], APPLY[x, IDX[x, APPLY[x, y]]]]");
+    auto actual_res = from_locally_nameless(sig, to_locally_nameless(term));
+
+    EXPECT_EQ(actual_res->get_head(), FUN);
+    auto& args = actual_res->get_args();
+    auto x = args[0]->get_head();
+    EXPECT_NE(x, sig.parse("x")->get_head());
+    EXPECT_EQ(*args[1], *sig.parse("KTYPE[x]"));
+    auto& args_IDX = args[2]->get_args()[1]->get_args();
+    EXPECT_NE(args_IDX[0]->get_head(), x);
+    EXPECT_EQ(*args_IDX[1], *create_term(APPLY, {args_IDX[0], sig.parse("y")}));
+    EXPECT_EQ(*to_deBruijn(sig, actual_res), *to_deBruijn(sig, term));
+}
+
+TEST(dhammerSyntaxTheory, locally_nameless_open_close) {
+    auto sig = dhammer_sig;
+
+    auto x = sig.parse("x")->get_head();
+    auto body = to_locally_nameless(sig.parse("APPLY[x, FUN[y, KTYPE[x], APPLY[y, x]]]"));
+
+    // closing and opening with the same variable is the identity
+    auto closed = ln_close(body, x);
+    EXPECT_EQ(*ln_open(closed, create_term(x)), *body);
+
+    // opening substitutes the variable
+    auto opened = ln_open(closed, sig.parse("z"));
+    EXPECT_EQ(*opened, *to_locally_nameless(sig.parse("APPLY[z, FUN[y, KTYPE[z], APPLY[y, z]]]")));
+
+    // the closed body is the body of the binder
+    auto binder = to_locally_nameless(sig.parse("IDX[x, APPLY[x, FUN[y, KTYPE[x], APPLY[y, x]]]]"));
+    EXPECT_EQ(*binder->get_args()[0], *closed);
+}
+
+TEST(dhammerSyntaxTheory, Substitution4) {
+    auto sig = dhammer_sig;
+
+    // the subterms without the variable are shared
+    auto initial_term = sig.parse("APPLY[FUN[y, KTYPE[T], APPLY[y, z]], x]");
+    auto var = sig.parse("x")->get_head();
+
+    auto actual_res = subst(sig, initial_term, var, sig.parse("w"));
+    EXPECT_EQ(*actual_res, *sig.parse("APPLY[FUN[y, KTYPE[T], APPLY[y, z]], w]"));
+    EXPECT_EQ(actual_res->get_args()[0].get(), initial_term->get_args()[0].get());
+
+    EXPECT_EQ(subst(sig, initial_term, sig.parse("u")->get_head(), sig.parse("w")).get(), initial_term.get());
+}
+
+TEST(dhammerSyntaxTheory, Substitution5) {
+    auto sig = dhammer_sig;
+
+    // the bound variable capturing the replacement is renamed, both in the binder and in the body
+    auto initial_term = sig.parse("FUN[y, KTYPE[T], APPLY[y, x]]");
+    auto var = sig.parse("x")->get_head();
+
+    auto actual_res = subst(sig, initial_term, var, sig.parse("y"));
+    auto& args = actual_res->get_args();
+    EXPECT_NE(args[0]->get_head(), sig.parse("y")->get_head());
+    EXPECT_EQ(*args[2], *create_term(APPLY, {args[0], sig.parse("y")}));
+}
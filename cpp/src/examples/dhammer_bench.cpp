@@ -0,0 +1,223 @@
+// The benchmark of the example suites. It runs without the Wolfram Engine.
+//
+// Usage: dhammer_bench [--suites=QCQI,CoqQ,...] [--warmup=N] [--reps=N] [--strategy=leftmost|innermost|parallel] [--json=FILE] [--csv=FILE]
+
+#include "dhammer.hpp"
+#include "examples.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+using namespace ualg;
+using namespace dhammer;
+using namespace examples;
+
+struct BenchResult {
+    string suite;
+    string name;
+    bool res;
+    bool expected_res;
+    // the latency of every repetition in milliseconds
+    vector<double> times;
+    // the statistics of the last repetition
+    size_t rewrite_steps;
+    size_t peak_terms;
+    size_t allocations;
+
+    double percentile(double p) const {
+        auto sorted = times;
+        sort(sorted.begin(), sorted.end());
+        auto i = size_t(ceil(p * sorted.size()));
+        return sorted[i == 0 ? 0 : i - 1];
+    }
+};
+
+const vector<pair<string, const vector<EqExample>*>> all_suites = {
+    {"QCQI", &QCQI_examples},
+    {"CoqQ", &CoqQ_examples},
+    {"Circuit", &Circuit_examples},
+    {"Jens2024", &Jens2024_examples},
+    {"others", &others_examples},
+    {"labelled_eq", &labelled_eq_examples},
+};
+
+const vector<pair<string, RewriteStrategy>> all_strategies = {
+    {"leftmost", RewriteStrategy::LEFTMOST_OUTERMOST},
+    {"innermost", RewriteStrategy::INNERMOST},
+    {"parallel", RewriteStrategy::PARALLEL_OUTERMOST},
+};
+
+/**
+ * @brief Check the example once by a fresh prover. The construction of the standard prover is not timed.
+ */
+void run_example(const EqExample& example, RewriteStrategy strategy, BenchResult& result) {
+    auto& bank = TermBank<int>::get_instance();
+
+    ostream null_output(nullptr);
+    auto prover = std_prover(nullptr, null_output);
+    prover.set_rewrite_strategy(strategy);
+    auto& kernel = prover.get_kernel();
+
+    auto steps_start = kernel.get_rewrite_steps();
+    auto created_start = bank.created_num();
+    bank.reset_peak_size();
+
+    auto start = chrono::steady_clock::now();
+    try {
+        prover.process(example.preproc_code);
+        result.res = prover.check_eq(example.termA, example.termB);
+    }
+    catch (const exception& e) {
+        result.res = false;
+    }
+    auto end = chrono::steady_clock::now();
+
+    result.times.push_back(chrono::duration<double, milli>(end - start).count());
+    result.rewrite_steps = kernel.get_rewrite_steps() - steps_start;
+    result.peak_terms = bank.peak_size();
+    result.allocations = bank.created_num() - created_start;
+}
+
+string json_escape(const string& str) {
+    string res;
+    for (auto c : str) {
+        if (c == '"' || c == '\\') {
+            res += '\\';
+        }
+        res += c;
+    }
+    return res;
+}
+
+void write_json(const string& path, const vector<BenchResult>& results, const string& strategy, int warmup, int reps) {
+    ofstream file(path);
+    file << "{" << endl;
+    file << "  \"strategy\": \"" << strategy << "\"," << endl;
+    file << "  \"warmup\": " << warmup << "," << endl;
+    file << "  \"reps\": " << reps << "," << endl;
+    file << "  \"examples\": [" << endl;
+    for (int i = 0; i < results.size(); i++) {
+        auto& r = results[i];
+        file << "    {\"suite\": \"" << json_escape(r.suite) << "\", \"name\": \"" << json_escape(r.name) << "\""
+             << ", \"res\": " << (r.res ? "true" : "false")
+             << ", \"expected_res\": " << (r.expected_res ? "true" : "false")
+             << ", \"median_ms\": " << r.percentile(0.5)
+             << ", \"p95_ms\": " << r.percentile(0.95)
+             << ", \"rewrite_steps\": " << r.rewrite_steps
+             << ", \"peak_terms\": " << r.peak_terms
+             << ", \"allocations\": " << r.allocations
+             << "}" << (i + 1 < results.size() ? "," : "") << endl;
+    }
+    file << "  ]" << endl;
+    file << "}" << endl;
+}
+
+void write_csv(const string& path, const vector<BenchResult>& results) {
+    ofstream file(path);
+    file << "suite, name, res, expected_res, median_ms, p95_ms, rewrite_steps, peak_terms, allocations" << endl;
+    for (const auto& r : results) {
+        file << r.suite << ", \"" << r.name << "\", " << r.res << ", " << r.expected_res << ", "
+             << r.percentile(0.5) << ", " << r.percentile(0.95) << ", "
+             << r.rewrite_steps << ", " << r.peak_terms << ", " << r.allocations << endl;
+    }
+}
+
+int main(int argc, const char** argv) {
+    vector<string> suites;
+    int warmup = 1;
+    int reps = 5;
+    string strategy_name = "leftmost";
+    string json_path;
+    string csv_path;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        auto eq = arg.find('=');
+        auto key = arg.substr(0, eq);
+        auto value = eq == string::npos ? "" : arg.substr(eq + 1);
+
+        if (key == "--suites") {
+            istringstream stream(value);
+            string suite;
+            while (getline(stream, suite, ',')) {
+                suites.push_back(suite);
+            }
+        }
+        else if (key == "--warmup") {
+            warmup = stoi(value);
+        }
+        else if (key == "--reps") {
+            reps = max(1, stoi(value));
+        }
+        else if (key == "--strategy") {
+            strategy_name = value;
+        }
+        else if (key == "--json") {
+            json_path = value;
+        }
+        else if (key == "--csv") {
+            csv_path = value;
+        }
+        else {
+            cerr << "Usage: dhammer_bench [--suites=QCQI,CoqQ,...] [--warmup=N] [--reps=N] [--strategy=leftmost|innermost|parallel] [--json=FILE] [--csv=FILE]" << endl;
+            return 1;
+        }
+    }
+
+    if (suites.empty()) {
+        for (const auto& [name, examples] : all_suites) {
+            suites.push_back(name);
+        }
+    }
+
+    auto strategy_res = find_if(all_strategies.begin(), all_strategies.end(), [&](const auto& p) { return p.first == strategy_name; });
+    if (strategy_res == all_strategies.end()) {
+        cerr << "Error: unknown strategy '" << strategy_name << "'." << endl;
+        return 1;
+    }
+    auto strategy = strategy_res->second;
+
+    vector<BenchResult> results;
+    for (const auto& suite : suites) {
+        auto find_res = find_if(all_suites.begin(), all_suites.end(), [&](const auto& p) { return p.first == suite; });
+        if (find_res == all_suites.end()) {
+            cerr << "Error: unknown suite '" << suite << "'." << endl;
+            return 1;
+        }
+
+        double suite_time = 0;
+        size_t suite_steps = 0;
+        for (const auto& example : *find_res->second) {
+            BenchResult result{suite, example.name, false, example.expected_res};
+
+            for (int i = 0; i < warmup; i++) {
+                BenchResult ignored;
+                run_example(example, strategy, ignored);
+            }
+            for (int i = 0; i < reps; i++) {
+                run_example(example, strategy, result);
+            }
+
+            cout << suite << "\t" << example.name << "\t" << result.percentile(0.5) << " ms\t" << result.percentile(0.95) << " ms\t"
+                 << result.rewrite_steps << " steps\t" << result.peak_terms << " peak terms\t" << result.allocations << " allocations" << endl;
+
+            suite_time += result.percentile(0.5);
+            suite_steps += result.rewrite_steps;
+            results.push_back(result);
+        }
+        cout << "SUITE " << suite << ": " << find_res->second->size() << " examples, " << suite_time << " ms (sum of medians), " << suite_steps << " steps" << endl;
+    }
+
+    if (!json_path.empty()) {
+        write_json(json_path, results, strategy_name, warmup, reps);
+    }
+    if (!csv_path.empty()) {
+        write_csv(csv_path, results);
+    }
+
+    return 0;
+}
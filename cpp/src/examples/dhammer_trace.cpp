@@ -0,0 +1,108 @@
+// The offline replay of the binary trace logs written at the FULL trace level.
+//
+// Usage: dhammer_trace LOG [--step=N] [--verify] [--counts] [--depth=N] [--width=N]
+//
+// Without options, it lists the steps. --step=N prints the term after step N, --verify reconstructs every step and
+// checks it against the hash in the log, and --counts prints the number of the steps of every rule.
+
+#include "dhammer.hpp"
+
+#include <fstream>
+
+using namespace std;
+using namespace ualg;
+using namespace dhammer;
+
+int main(int argc, char** argv) {
+    string log_path;
+    optional<size_t> step_index;
+    bool verify = false;
+    bool counts = false;
+    PrintOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.rfind("--step=", 0) == 0) {
+            step_index = stoul(arg.substr(7));
+        }
+        else if (arg == "--verify") {
+            verify = true;
+        }
+        else if (arg == "--counts") {
+            counts = true;
+        }
+        else if (arg.rfind("--depth=", 0) == 0) {
+            options.max_depth = stoul(arg.substr(8));
+        }
+        else if (arg.rfind("--width=", 0) == 0) {
+            options.max_width = stoul(arg.substr(8));
+        }
+        else if (log_path.empty() && arg.rfind("--", 0) != 0) {
+            log_path = arg;
+        }
+        else {
+            cerr << "Unknown argument: " << arg << endl;
+            return 1;
+        }
+    }
+
+    if (log_path.empty()) {
+        cerr << "Usage: dhammer_trace LOG [--step=N] [--verify] [--counts] [--depth=N] [--width=N]" << endl;
+        return 1;
+    }
+
+    ifstream file(log_path, ios::binary);
+    if (!file.is_open()) {
+        cerr << "Cannot open the trace log '" << log_path << "'." << endl;
+        return 1;
+    }
+
+    try {
+        TraceLogReader reader(file);
+        const auto& steps = reader.get_steps();
+
+        if (step_index.has_value()) {
+            if (*step_index >= steps.size()) {
+                cerr << "The log has only " << steps.size() << " steps." << endl;
+                return 1;
+            }
+            const auto& step = steps[*step_index];
+            cout << "step " << *step_index << ": " << reader.get_step_name(step) << endl;
+            cout << "initial term: " << reader.term_to_string(reader.initial_term(*step_index), options) << endl;
+            cout << "term: " << reader.term_to_string(reader.term_after(*step_index), options) << endl;
+            return 0;
+        }
+
+        if (counts) {
+            CountSink sink;
+            for (const auto& step : steps) {
+                sink.count(reader.get_step_name(step));
+            }
+            cout << sink.to_string();
+            return 0;
+        }
+
+        if (verify) {
+            size_t mismatches = 0;
+            for (size_t i = 0; i < steps.size(); i++) {
+                if (reader.term_after(i)->get_hash() != steps[i].final_hash) {
+                    cout << "step " << i << " (" << reader.get_step_name(steps[i]) << "): hash mismatch" << endl;
+                    mismatches++;
+                }
+            }
+            cout << steps.size() << " steps, " << mismatches << " mismatches" << endl;
+            return mismatches == 0 ? 0 : 2;
+        }
+
+        for (size_t i = 0; i < steps.size(); i++) {
+            const auto& step = steps[i];
+            cout << i << "\t" << reader.get_step_name(step) << "\t" << pos_to_string(step.pos) << endl;
+        }
+    }
+    catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
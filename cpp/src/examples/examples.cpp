@@ -1,5 +1,10 @@
 #include "examples.hpp"
 
+#include <atomic>
+#include <ctime>
+#include <sstream>
+#include <thread>
+
 
 namespace examples {
 
@@ -32,6 +37,122 @@ namespace examples {
         return res;
     }
 
+    int BatchReport::failure_num() const {
+        int res = 0;
+        for (const auto& result : results) {
+            if (result.res != result.expected_res) {
+                res++;
+            }
+        }
+        return res;
+    }
+
+    std::string BatchReport::to_string() const {
+        std::ostringstream res;
+        for (const auto& result : results) {
+            res << result.name << ": " << (result.res ? "EQUAL" : "NOT EQUAL");
+            if (result.res != result.expected_res) {
+                res << " (UNEXPECTED)";
+            }
+            res << ", " << result.time << " s" << endl;
+        }
+        res << "Example Number: " << results.size() << endl;
+        res << "Failure Number: " << failure_num() << endl;
+        res << "WALL TIME: " << wall_time << " s" << endl;
+        res << "CPU TIME: " << cpu_time << " s" << endl;
+        if (speedup > 0) {
+            res << "SERIAL TIME: " << serial_time << " s" << endl;
+            res << "SPEEDUP: " << speedup << endl;
+        }
+        return res.str();
+    }
+
+    /**
+     * @brief Check the examples on `thread_num` threads, and return the wall-clock time in seconds.
+     */
+    float _run_batch(const std::vector<EqExample>& examples, unsigned thread_num, WSLINK lp, BatchReport& report) {
+        report.results.assign(examples.size(), BatchResult{});
+
+        // the next example to check
+        std::atomic<std::size_t> next = 0;
+
+        auto worker = [&]() {
+            while (true) {
+                auto i = next++;
+                if (i >= examples.size()) {
+                    break;
+                }
+
+                auto& example = examples[i];
+                auto& result = report.results[i];
+                result.name = example.name;
+                result.expected_res = example.expected_res;
+
+                std::ostringstream output;
+                auto start = std::chrono::steady_clock::now();
+                try {
+                    auto prover = std_prover(lp, output);
+                    result.res = prover.process(example.preproc_code);
+                    if (!example.termA.empty() || !example.termB.empty()) {
+                        result.res = result.res && prover.check_eq(example.termA, example.termB);
+                    }
+                }
+                catch (const std::exception& e) {
+                    output << "Error: " << e.what() << endl;
+                    result.res = false;
+                }
+                auto end = std::chrono::steady_clock::now();
+
+                result.time = std::chrono::duration<float>(end - start).count();
+                result.output = output.str();
+            }
+        };
+
+        auto wall_start = std::chrono::steady_clock::now();
+
+        std::vector<std::thread> threads;
+        for (unsigned i = 0; i < std::min<std::size_t>(thread_num, examples.size()); i++) {
+            threads.emplace_back(worker);
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        auto wall_end = std::chrono::steady_clock::now();
+        return std::chrono::duration<float>(wall_end - wall_start).count();
+    }
+
+    BatchReport batch_check_eq(const std::vector<EqExample>& examples, unsigned thread_num, WSLINK lp, bool measure_speedup) {
+        if (thread_num == 0) {
+            thread_num = std::max(1u, std::thread::hardware_concurrency());
+        }
+        // the terms can only be used by one thread at a time without atomic reference counts
+        if (!ualg::Term<int>::RefCount::thread_safe) {
+            thread_num = 1;
+        }
+
+        BatchReport report;
+
+        auto cpu_start = std::clock();
+        report.wall_time = _run_batch(examples, thread_num, lp, report);
+        auto cpu_end = std::clock();
+        report.cpu_time = float(cpu_end - cpu_start) / CLOCKS_PER_SEC;
+
+        if (measure_speedup) {
+            if (thread_num == 1) {
+                report.serial_time = report.wall_time;
+            }
+            else {
+                // the same batch on one thread, whose results are discarded
+                BatchReport serial_report;
+                report.serial_time = _run_batch(examples, 1, lp, serial_report);
+            }
+            report.speedup = report.wall_time > 0 ? report.serial_time / report.wall_time : 0;
+        }
+
+        return report;
+    }
+
 
     std::vector<EqExample> QCQI_examples = {
 /*
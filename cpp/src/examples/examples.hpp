@@ -19,6 +19,48 @@ namespace examples {
      * @return std::vector<std::pair<std::string, float>> 
      */
     std::vector<std::pair<std::string, float>> timing_examples(const std::vector<EqExample>& examples);
+
+    struct BatchResult {
+        std::string name;
+        bool res = false;
+        bool expected_res = true;
+        // the running time of this example in seconds
+        float time = 0;
+        // the output of the prover, including the error message if an exception is thrown
+        std::string output;
+    };
+
+    struct BatchReport {
+        // the results in the order of the input examples
+        std::vector<BatchResult> results;
+        // the wall-clock time and the CPU time of the whole batch in seconds
+        float wall_time = 0;
+        float cpu_time = 0;
+        // the wall-clock time of the same batch on one thread in seconds
+        float serial_time = 0;
+        // the serial time divided by the wall-clock time, or 0 if the serial time is not measured
+        float speedup = 0;
+
+        /**
+         * @brief Return the number of examples whose result differs from the expected one.
+         */
+        int failure_num() const;
+
+        std::string to_string() const;
+    };
+
+    /**
+     * @brief Check the examples on a pool of threads. Every example is checked by a fresh standard prover with its own output stream.
+     * An example with empty `termA` and `termB` only processes `preproc_code`, so that scripts of CheckEq commands can be run as well.
+     * 
+     * @param examples 
+     * @param thread_num The number of worker threads. 0 means std::thread::hardware_concurrency(). Only one thread is used if the terms are not reference counted atomically.
+     * @param lp The Wolfram Engine link shared by the workers. nullptr means not connected.
+     * @param measure_speedup Whether the batch is checked again on one thread, to measure the speedup by the wall-clock times.
+     * It doubles the running time, so it is only meant for the timing runs.
+     * @return BatchReport 
+     */
+    BatchReport batch_check_eq(const std::vector<EqExample>& examples, unsigned thread_num = 0, WSLINK lp = nullptr, bool measure_speedup = false);
     
 
     extern std::vector<EqExample> QCQI_examples;
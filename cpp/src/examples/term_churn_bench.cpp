@@ -0,0 +1,93 @@
+// The micro-benchmark of the term node allocation. It creates and releases many short-lived nodes, first through the
+// term bank with the configured allocator, and then directly with the pool and the standard allocators.
+//
+// Usage: term_churn_bench [--reps=N]
+
+#include "dhammer.hpp"
+
+#include <chrono>
+#include <limits>
+
+using namespace std;
+using namespace ualg;
+
+// The same layout as the term nodes, for the direct comparison of the allocators.
+struct NodeStub {
+    alignas(Term<int>) char data[sizeof(Term<int>)];
+};
+
+/**
+ * @brief Run the churn for the given repetitions, and print the best time and the throughput in nodes per second.
+ */
+template <class F>
+void run(const string& name, int reps, size_t node_num, F churn) {
+    double best = numeric_limits<double>::max();
+    size_t checksum = 0;
+    for (int i = 0; i < reps; i++) {
+        auto start = chrono::steady_clock::now();
+        checksum += churn();
+        auto end = chrono::steady_clock::now();
+        best = min(best, chrono::duration<double>(end - start).count());
+    }
+    cout << name << "\t" << best * 1000 << " ms\t" << node_num / best / 1e6 << " M nodes/s\t(checksum " << checksum << ")" << endl;
+}
+
+/**
+ * @brief Create and release the nodes in rounds, keeping one round alive at a time.
+ */
+template <class Alloc>
+size_t allocator_churn(size_t rounds, size_t round_size) {
+    size_t checksum = 0;
+    for (size_t round = 0; round < rounds; round++) {
+        vector<shared_ptr<NodeStub>> keep;
+        keep.reserve(round_size);
+        for (size_t i = 0; i < round_size; i++) {
+            keep.push_back(allocate_shared<NodeStub>(Alloc()));
+        }
+        checksum += keep.size();
+    }
+    return checksum;
+}
+
+int main(int argc, const char** argv) {
+    int reps = 5;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.rfind("--reps=", 0) == 0) {
+            reps = max(1, stoi(arg.substr(7)));
+        }
+        else {
+            cerr << "Usage: term_churn_bench [--reps=N]" << endl;
+            return 1;
+        }
+    }
+
+    const size_t rounds = 20;
+    const size_t round_size = 50000;
+    // every compound term comes with two new leaves
+    const size_t node_num = rounds * round_size * 3;
+    cout << "UALG_TERM_POOL=" << UALG_TERM_POOL << ", " << node_num << " nodes, " << reps << " repetitions" << endl;
+
+    run("make_term (term bank)", reps, node_num, [&]() {
+        size_t checksum = 0;
+        for (size_t round = 0; round < rounds; round++) {
+            vector<TermPtr<int>> keep;
+            keep.reserve(round_size);
+            for (size_t i = 0; i < round_size; i++) {
+                int leaf = static_cast<int>(2 * (i + round * round_size));
+                keep.push_back(make_term<int>(1, {make_term<int>(leaf), make_term<int>(leaf + 1)}));
+            }
+            checksum += keep.size();
+        }
+        return checksum;
+    });
+
+    run("allocate_shared (pool)", reps, node_num / 3, [&]() {
+        return allocator_churn<PoolAllocator<NodeStub>>(rounds, round_size);
+    });
+    run("allocate_shared (std)", reps, node_num / 3, [&]() {
+        return allocator_churn<std::allocator<NodeStub>>(rounds, round_size);
+    });
+
+    return 0;
+}
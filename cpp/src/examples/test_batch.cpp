@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+
+#include "dhammer.hpp"
+#include "examples.hpp"
+
+using namespace ualg;
+using namespace std;
+using namespace dhammer;
+using namespace examples;
+
+// The batch driver without the Wolfram Engine.
+
+TEST(TestBatch, Results) {
+    const string preproc = R"(
+        Var a : STYPE.
+        Var b : STYPE.
+        Var T : INDEX.
+        Var K : KTYPE[T].
+    )";
+
+    vector<EqExample> examples = others_examples;
+    for (int i = 0; i < 4; i++) {
+        auto suffix = "-" + to_string(i);
+        examples.push_back({"EQ" + suffix, preproc, "a b K", "(a*b).K"});
+        examples.push_back({"NEQ" + suffix, preproc, "a K", "b K", false});
+        // only the script is processed
+        examples.push_back({"SCRIPT" + suffix, preproc + "CheckEq a b K with (a*b).K.", "", ""});
+        // the errors are reported as failed checks
+        examples.push_back({"ERROR" + suffix, preproc, "a +", "a", false});
+    }
+
+    auto report = batch_check_eq(examples, 4, nullptr);
+
+    ASSERT_EQ(report.results.size(), examples.size());
+    for (int i = 0; i < examples.size(); i++) {
+        EXPECT_EQ(report.results[i].name, examples[i].name);
+        EXPECT_EQ(report.results[i].res, examples[i].expected_res) << report.results[i].output;
+    }
+    EXPECT_EQ(report.failure_num(), 0);
+
+    // the speedup is only measured on demand
+    EXPECT_EQ(report.speedup, 0);
+}
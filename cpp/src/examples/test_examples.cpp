@@ -86,4 +86,35 @@ INSTANTIATE_TEST_SUITE_P(
     LabelledEqExampleTests,  // Test suite name
     EqExampleTest,   // Test case class
     ::testing::ValuesIn(labelled_eq_examples)  // Provide the vector of examples
-);
\ No newline at end of file
+);
+
+// The rewriting strategies should decide the equalities in the same way as the default one.
+class EqStrategyTest : public ::testing::TestWithParam<EqExample> {
+protected:
+    void RunTest(const EqExample& example) {
+        cout << "TEST NAME: " << example.name << endl;
+
+        auto check = [&](RewriteStrategy strategy) {
+            auto new_prover = init_prover();
+            new_prover->set_rewrite_strategy(strategy);
+            new_prover->process(example.preproc_code);
+            return new_prover->check_eq(example.termA, example.termB);
+        };
+
+        auto expected = check(RewriteStrategy::LEFTMOST_OUTERMOST);
+        EXPECT_EQ(check(RewriteStrategy::INNERMOST), expected);
+        EXPECT_EQ(check(RewriteStrategy::PARALLEL_OUTERMOST), expected);
+    }
+};
+
+TEST_P(EqStrategyTest, SameResult) {
+    EqExample example = GetParam();
+    RunTest(example);
+}
+
+INSTANTIATE_TEST_SUITE_P(QCQI_Strategy, EqStrategyTest, ::testing::ValuesIn(QCQI_examples));
+INSTANTIATE_TEST_SUITE_P(CoqQ_Strategy, EqStrategyTest, ::testing::ValuesIn(CoqQ_examples));
+INSTANTIATE_TEST_SUITE_P(Circuit_Strategy, EqStrategyTest, ::testing::ValuesIn(Circuit_examples));
+INSTANTIATE_TEST_SUITE_P(Jens2024_Strategy, EqStrategyTest, ::testing::ValuesIn(Jens2024_examples));
+INSTANTIATE_TEST_SUITE_P(Others_Strategy, EqStrategyTest, ::testing::ValuesIn(others_examples));
+INSTANTIATE_TEST_SUITE_P(LabelledEq_Strategy, EqStrategyTest, ::testing::ValuesIn(labelled_eq_examples));
@@ -49,4 +49,83 @@ TEST(TestTiming, Circuit) {
 
 TEST(TestTiming, Jens2024) {
     test_examples(Jens2024_examples);
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Check the examples with the nf cache off and on, and return the cache statistics of the latter.
+ */
+CacheStats test_nf_cache(const vector<EqExample>& examples) {
+
+    // without the Wolfram Engine, so that the results only depend on the rewriting
+    vector<bool> results[2];
+    CacheStats res_stats;
+
+    for (auto enabled : {false, true}) {
+        CacheStats stats;
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        for (auto example : examples) {
+            std::ostringstream output;
+            auto prover = std_prover(nullptr, output);
+            prover.get_kernel().set_nf_cache_enabled(enabled);
+            bool res = false;
+            try {
+                prover.process(example.preproc_code);
+                res = prover.check_eq(example.termA, example.termB);
+            }
+            catch (const std::exception& e) {
+                res = false;
+            }
+            results[enabled].push_back(res);
+            stats.hits += prover.get_kernel().get_nf_cache_stats().hits;
+            stats.misses += prover.get_kernel().get_nf_cache_stats().misses;
+        }
+
+        auto end = std::chrono::high_resolution_clock::now();
+
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+        std::cout << "NF CACHE: " << (enabled ? "ON" : "OFF") << std::endl;
+        std::cout << "DURATION: " << duration.count() << " ms" << std::endl;
+        if (enabled) {
+            std::cout << "NORMALIZATIONS: " << stats.misses << " (" << stats.hits << " cache hits)" << std::endl;
+            res_stats = stats;
+        }
+    }
+
+    // the cache does not change the results
+    for (int i = 0; i < examples.size(); i++) {
+        EXPECT_EQ(results[true][i], results[false][i]) << examples[i].name;
+    }
+    return res_stats;
+}
+
+TEST(TestTiming, QCQI_NFCache) {
+    test_nf_cache(QCQI_examples);
+}
+
+TEST(TestTiming, CoqQ_NFCache) {
+    // the lemmas of CoqQ share many subterms
+    EXPECT_GT(test_nf_cache(CoqQ_examples).hits, 0);
+}
+
+TEST(TestTiming, Batch) {
+
+    // use the Wolfram Engine on MacOS
+    auto [ep, lp] = wstp::init_and_openlink(wstp::MACOS_ARGC, wstp::MACOS_ARGV);
+
+    vector<EqExample> all_examples;
+    for (auto examples : {&QCQI_examples, &CoqQ_examples, &Circuit_examples, &Jens2024_examples, &others_examples, &labelled_eq_examples}) {
+        all_examples.insert(all_examples.end(), examples->begin(), examples->end());
+    }
+
+    auto report = batch_check_eq(all_examples, 0, lp, true);
+
+    ASSERT_EQ(report.results.size(), all_examples.size());
+    for (int i = 0; i < all_examples.size(); i++) {
+        EXPECT_EQ(report.results[i].name, all_examples[i].name);
+    }
+
+    std::cout << report.to_string();
+}
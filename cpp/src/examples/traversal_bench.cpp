@@ -0,0 +1,160 @@
+// The micro-benchmark of the read-only term traversals. It compares the borrowed traversals in dhammer with the
+// owning style they replaced, where every level copies the argument list and passes the terms by value.
+//
+// Usage: traversal_bench [--reps=N]
+
+#include "dhammer.hpp"
+#include "examples.hpp"
+
+#include <chrono>
+
+using namespace std;
+using namespace ualg;
+using namespace dhammer;
+using namespace examples;
+
+//////////////////////////////////////////////
+// The owning traversals, as a reference
+
+void owning_bound_vars(TermPtr<int> term, std::set<int>& res) {
+    if (term->is_atomic()) {
+        return;
+    }
+
+    auto head = term->get_head();
+    ListArgs<int> args = term->get_args();
+
+    if (head == FUN) {
+        res.insert(args[0]->get_head());
+    }
+
+    for (const auto& arg : args) {
+        owning_bound_vars(arg, res);
+    }
+}
+
+int owning_comp(TermPtr<int> termA, TermPtr<int> termB, std::set<int> bound_vars) {
+    auto headA = termA->get_head();
+    auto headB = termB->get_head();
+
+    ListArgs<int> argsA = termA->get_args();
+    ListArgs<int> argsB = termB->get_args();
+
+    if (bound_vars.find(headA) != bound_vars.end()) {
+        headA = std::numeric_limits<int>::max();
+    }
+    if (bound_vars.find(headB) != bound_vars.end()) {
+        headB = std::numeric_limits<int>::max();
+    }
+
+    if (headA != headB) {
+        return (headA < headB)? -1 : 1;
+    }
+
+    auto shortest_len = std::min(argsA.size(), argsB.size());
+    for (int i = 0; i < shortest_len; i++) {
+        auto res = owning_comp(argsA[i], argsB[i], bound_vars);
+        if (res != 0) {
+            return res;
+        }
+    }
+
+    if (argsA.size() != argsB.size()) {
+        return (argsA.size() < argsB.size())? -1 : 1;
+    }
+    return 0;
+}
+
+//////////////////////////////////////////////
+// Benchmark
+
+/**
+ * @brief Collect the terms of all examples, together with their normal forms.
+ */
+vector<TermPtr<int>> collect_terms() {
+    vector<TermPtr<int>> terms;
+    ostream null_output(nullptr);
+
+    for (const auto& suite : {&QCQI_examples, &CoqQ_examples, &Circuit_examples, &Jens2024_examples, &others_examples, &labelled_eq_examples}) {
+        for (const auto& example : *suite) {
+            auto prover = std_prover(nullptr, null_output);
+            auto& kernel = prover.get_kernel();
+            try {
+                prover.process(example.preproc_code);
+                for (const auto& code : {example.termA, example.termB}) {
+                    auto ast = dhammer::parse(code);
+                    if (!ast.has_value()) {
+                        continue;
+                    }
+                    auto term = kernel.parse(*ast);
+                    terms.push_back(term);
+                    terms.push_back(kernel.normal_form(term));
+                }
+            }
+            catch (const exception& e) {
+                continue;
+            }
+        }
+    }
+    return terms;
+}
+
+/**
+ * @brief Run the traversal on all terms for the given repetitions, and print the throughput in nodes per second.
+ */
+template <class F>
+void run(const string& name, const vector<TermPtr<int>>& terms, int reps, F traversal) {
+    size_t node_num = 0;
+    for (const auto& term : terms) {
+        node_num += term->get_term_size();
+    }
+
+    size_t checksum = 0;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < reps; i++) {
+        for (const auto& term : terms) {
+            checksum += traversal(term);
+        }
+    }
+    auto end = chrono::steady_clock::now();
+
+    auto seconds = chrono::duration<double>(end - start).count();
+    cout << name << "\t" << seconds * 1000 << " ms\t" << node_num * reps / seconds / 1e6 << " M nodes/s\t(checksum " << checksum << ")" << endl;
+}
+
+int main(int argc, const char** argv) {
+    int reps = 200;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.rfind("--reps=", 0) == 0) {
+            reps = max(1, stoi(arg.substr(7)));
+        }
+        else {
+            cerr << "Usage: traversal_bench [--reps=N]" << endl;
+            return 1;
+        }
+    }
+
+    auto terms = collect_terms();
+    cout << terms.size() << " terms, " << reps << " repetitions" << endl;
+
+    run("bound_vars (owning)", terms, reps, [](const TermPtr<int>& term) {
+        std::set<int> res;
+        owning_bound_vars(term, res);
+        return res.size();
+    });
+    run("bound_vars (borrowed)", terms, reps, [](const TermPtr<int>& term) {
+        return get_bound_vars(term).size();
+    });
+
+    run("comp_modulo_bound_vars (owning)", terms, reps, [](const TermPtr<int>& term) {
+        std::set<int> bound_vars = get_bound_vars(term);
+        return size_t(owning_comp(term, term, bound_vars) == 0);
+    });
+    run("comp_modulo_bound_vars (borrowed)", terms, reps, [](const TermPtr<int>& term) {
+        std::set<int> bound_vars = get_bound_vars(term);
+        return size_t(!comp_modulo_bound_vars(term, term, bound_vars));
+    });
+
+    return 0;
+}
@@ -23,7 +23,7 @@ namespace ualg {
         // If the term is atomic or not an AC symbol, return the term
         if (term->is_atomic() || c_symbols.find(term->get_head()) == c_symbols.end()) return term;
 
-        const ListArgs<T>& args = term->get_args();
+        auto& args = term->get_args();
         ListArgs<T> new_args;
 
         for (const auto& arg : args) {
@@ -39,7 +39,7 @@ namespace ualg {
             }
         }
 
-        return std::make_shared<Term<T>>(term->get_head(), std::move(new_args));
+        return make_term(term->get_head(), std::move(new_args));
     }
     
     /**
@@ -56,7 +56,7 @@ namespace ualg {
 
         if (term->get_args().size() == 0) return term;
 
-        const ListArgs<T>& args = term->get_args();
+        auto& args = term->get_args();
         
         // sort within the arguments
         ListArgs<T> res_subterm_sort;
@@ -72,7 +72,7 @@ namespace ualg {
             std::sort(res_subterm_sort.begin(), res_subterm_sort.end(), comp);
         }
 
-        return  std::make_shared<Term<T>>(term->get_head(), std::move(res_subterm_sort));
+        return make_term(term->get_head(), std::move(res_subterm_sort));
     }
 
     /**
@@ -85,7 +85,7 @@ namespace ualg {
      * @return false 
      */
     template <class T>
-    bool std_comp(TermPtr<T> a, TermPtr<T> b) {
+    bool std_comp(const TermPtr<T>& a, const TermPtr<T>& b) {
         return *a < *b;
     }
 
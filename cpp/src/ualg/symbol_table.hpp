@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Set UALG_DENSE_SIGNATURE to 0 to store the symbols of int heads in std::map, as for the other head types.
+#ifndef UALG_DENSE_SIGNATURE
+#define UALG_DENSE_SIGNATURE 1
+#endif
+
+namespace ualg {
+
+    /**
+     * @brief The two-way mapping between the head names and the heads of a Signature.
+     *
+     * @tparam T The type of the heads.
+     */
+    template <class T>
+    class SymbolTable {
+    protected:
+        std::map<T, std::string> head2name;
+        std::map<std::string, T, std::less<>> name2head;
+
+    public:
+        inline std::optional<T> find_head(std::string_view name) const {
+            auto find = name2head.find(name);
+            if (find == name2head.end()) {
+                return std::nullopt;
+            }
+            return find->second;
+        }
+
+        /**
+         * @brief Return the name of the head, or nullptr if the head is not in the table.
+         */
+        inline const std::string* find_name(const T& head) const {
+            auto find = head2name.find(head);
+            if (find == head2name.end()) {
+                return nullptr;
+            }
+            return &find->second;
+        }
+
+        inline void add(std::string_view name, const T& head) {
+            name2head.insert_or_assign(std::string(name), head);
+            head2name[head] = name;
+        }
+
+        /**
+         * @brief Return the number of the heads in the table.
+         */
+        inline std::size_t size() const {
+            return head2name.size();
+        }
+    };
+
+#if UALG_DENSE_SIGNATURE
+    /**
+     * @brief The symbol table of int heads, which are dense from 0.
+     *
+     * The names are stored in a vector indexed by the heads. The name lookup goes through an open addressing hash
+     * table with linear probing, whose slots keep the heads and the hashes of their names, so that the names are
+     * stored only once and looked up by std::string_view without constructing strings.
+     */
+    template <>
+    class SymbolTable<int> {
+    protected:
+        struct Slot {
+            std::size_t hash;
+            // -1 means the slot is empty.
+            int head;
+        };
+
+        // The names indexed by the heads. The empty names are the heads not in the table.
+        std::vector<std::string> names;
+        std::size_t head_num = 0;
+
+        // The capacity is a power of 2, and at most half of the slots are used.
+        std::vector<Slot> slots = std::vector<Slot>(16, Slot{0, -1});
+        std::size_t slot_num = 0;
+
+        static inline std::size_t _hash(std::string_view name) {
+            return std::hash<std::string_view>{}(name);
+        }
+
+        /**
+         * @brief Return the slot of the name, which is the empty slot to insert it at if the name is not in the table.
+         */
+        inline Slot& _find_slot(std::string_view name, std::size_t hash) {
+            return const_cast<Slot&>(static_cast<const SymbolTable&>(*this)._find_slot(name, hash));
+        }
+
+        inline const Slot& _find_slot(std::string_view name, std::size_t hash) const {
+            auto mask = slots.size() - 1;
+            for (auto i = hash & mask; ; i = (i + 1) & mask) {
+                const auto& slot = slots[i];
+                if (slot.head == -1 || (slot.hash == hash && names[slot.head] == name)) {
+                    return slot;
+                }
+            }
+        }
+
+        void _rehash(std::size_t slot_capacity) {
+            std::vector<Slot> old_slots(slot_capacity, Slot{0, -1});
+            old_slots.swap(slots);
+            for (const auto& slot : old_slots) {
+                if (slot.head != -1) {
+                    _find_slot(names[slot.head], slot.hash) = slot;
+                }
+            }
+        }
+
+    public:
+        inline std::optional<int> find_head(std::string_view name) const {
+            const auto& slot = _find_slot(name, _hash(name));
+            if (slot.head == -1) {
+                return std::nullopt;
+            }
+            return slot.head;
+        }
+
+        /**
+         * @brief Return the name of the head, or nullptr if the head is not in the table.
+         */
+        inline const std::string* find_name(int head) const {
+            if (head < 0 || static_cast<std::size_t>(head) >= names.size() || names[head].empty()) {
+                return nullptr;
+            }
+            return &names[head];
+        }
+
+        inline void add(std::string_view name, int head) {
+            // the names are indexed by the heads, and -1 marks the empty slots
+            if (head < 0) {
+                throw std::runtime_error("Negative head for symbol: " + std::string(name));
+            }
+
+            if ((slot_num + 1) * 2 > slots.size()) {
+                _rehash(slots.size() * 2);
+            }
+
+            if (static_cast<std::size_t>(head) >= names.size()) {
+                names.resize(head + 1);
+            }
+            if (names[head].empty()) {
+                ++head_num;
+            }
+            names[head] = name;
+
+            auto hash = _hash(name);
+            auto& slot = _find_slot(name, hash);
+            if (slot.head == -1) {
+                ++slot_num;
+            }
+            slot = {hash, head};
+        }
+
+        /**
+         * @brief Return the number of the heads in the table.
+         */
+        inline std::size_t size() const {
+            return head_num;
+        }
+    };
+#endif
+
+} // namespace ualg
@@ -2,6 +2,18 @@
 
 #include <string>
 #include <set>
+#include <map>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+#include "term_pool.hpp"
+#include "term_ptr.hpp"
+#include "term_args.hpp"
 
 namespace ualg {
 
@@ -19,12 +31,39 @@ namespace ualg {
     template <class T>
     class Term;
 
+    /**
+     * @brief The reference counting policy of the terms with head type T. Specialize it to choose the policy for a
+     * head type, e.g., PlainRefCount if the terms are only used by one thread.
+     */
+    template <class T>
+    struct TermRefCountPolicy {
+        using type = DefaultRefCount;
+    };
+
+    template <class T>
+    using TermPtr = IntrusivePtr<const Term<T>>;
+
+    // The borrowed reference to a term. It is used by the read-only traversals, which neither keep the term nor touch the reference counts.
     template <class T>
-    using TermPtr = std::shared_ptr<const Term<T>>;
+    using TermRef = const Term<T>&;
 
     template <class T>
     using ListArgs = std::vector<TermPtr<T>>;
 
+    // The argument list stored in the terms. Short lists are stored inline.
+    template <class T>
+    using TermArgs = SmallArgs<TermPtr<T>>;
+
+    template <class T>
+    class TermBank;
+
+    /**
+     * @brief The allocator of the nodes created by the TermBank. The nodes are allocated from size-class pools,
+     * unless UALG_TERM_POOL is set to 0.
+     */
+    template <class T>
+    using TermAllocator = std::conditional_t<UALG_TERM_POOL, PoolAllocator<Term<T>>, std::allocator<Term<T>>>;
+
     enum COMPARE_TYPE {
         EQUAL,
         LESS,
@@ -34,13 +73,38 @@ namespace ualg {
     /**
      * @brief The abstract class for terms.
      * 
+     * The terms are reference counted intrusively, according to TermRefCountPolicy<T>. The terms referred by TermPtr
+     * should be created by make_term or make_raw_term.
+     *
      * @tparam T The type of the head(data) of the term. The function std::string data_to_string(const T&) and std::size_t hash_value(const T&) should be defined.
      */
     template <class T>
-    class Term : public std::enable_shared_from_this<Term<T>> {
+    class Term {
+    public:
+        using RefCount = typename TermRefCountPolicy<T>::type;
+
     protected:
+        mutable typename RefCount::counter_type ref_counter{0};
+
         T head;
-        ListArgs<T> args;
+        TermArgs<T> args;
+
+        // The structural information computed once at construction.
+        std::size_t hash_value;
+        std::size_t term_size;
+        std::size_t depth;
+        // The Bloom-style summary of the heads in the term: the union of head_bit over all the subterms.
+        std::uint64_t head_mask;
+
+        void init_structure_info();
+
+        // Whether the term is the unique representative stored in the TermBank.
+        bool interned = false;
+
+        // The next node in the same bucket of the TermBank.
+        Term<T>* bank_next = nullptr;
+
+        friend class TermBank<T>;
 
     public: 
         Term(const T& head);
@@ -48,7 +112,7 @@ namespace ualg {
         Term(const T& head, ListArgs<T>&& args);
 
         const T& get_head() const;
-        const ListArgs<T>& get_args() const;
+        const TermArgs<T>& get_args() const;
 
         COMPARE_TYPE compare(const Term<T>& other) const;
 
@@ -56,22 +120,212 @@ namespace ualg {
         bool operator < (const Term<T>& other) const;
         bool operator != (const Term& other) const;
 
+        /**
+         * @brief Compute the structural hash of the term with the given head and arguments.
+         */
+        static std::size_t calc_hash(const T& head, std::span<const TermPtr<T>> args);
+
+        /**
+         * @brief Combine the hash of the next argument into the hash of a term, as calc_hash does.
+         */
+        static std::size_t combine_hash(std::size_t h, std::size_t arg_hash);
+
+        std::size_t get_hash() const;
+
         std::size_t get_term_size() const;
 
+        std::size_t get_depth() const;
+
+        /**
+         * @brief The bit of the head in the head masks.
+         */
+        static std::uint64_t head_bit(const T& head);
+
+        std::uint64_t get_head_mask() const;
+
+        /**
+         * @brief Check whether the head may occur in the term. false means that it does not occur for sure, so the
+         * traversals looking for the head can skip the whole term.
+         */
+        bool may_contain(const T& head) const;
+
         bool is_atomic() const;
 
+        bool is_interned() const;
+
         std::string to_string(const std::map<T, std::string>* head_naming=nullptr) const;
 
+        /**
+         * @brief Append the string of the term to `res`, in one pass over the term.
+         */
+        void append_to(std::string& res, const std::map<T, std::string>* head_naming=nullptr) const;
+
         TermPtr<T> get_subterm(const TermPos& pos) const;
 
         TermPtr<T> replace_term(TermPtr<T> pattern, TermPtr<T> replacement) const;
 
         TermPtr<T> replace_at(const TermPos& pos, TermPtr<T> new_subterm) const;
 
-        virtual ~Term() = default;
+        /**
+         * @brief Add a reference to the term. It is called by TermPtr.
+         */
+        void add_ref() const;
+
+        /**
+         * @brief Remove a reference to the term, and destroy it if it is the last one. It is called by TermPtr.
+         */
+        void release() const;
+
+        std::size_t ref_count() const;
+
+        virtual ~Term();
     
     };
 
+    /**
+     * @brief The hash functor for TermPtr, based on the structural hash.
+     */
+    template <class T>
+    struct TermPtrHash {
+        std::size_t operator()(const TermPtr<T>& term) const {
+            return term->get_hash();
+        }
+    };
+
+    /**
+     * @brief The equality functor for TermPtr, based on the structural equality.
+     */
+    template <class T>
+    struct TermPtrEqual {
+        bool operator()(const TermPtr<T>& a, const TermPtr<T>& b) const {
+            return *a == *b;
+        }
+    };
+
+
+    /**
+     * @brief The hash-consing table for terms.
+     * 
+     * All terms created through the bank are maximally shared: two structurally equal terms are represented by the
+     * same node. Therefore the equality of interned terms is decided by a pointer comparison.
+     * 
+     * The bank does not own the terms. The buckets are chained through the nodes themselves, and an interned term
+     * removes itself from the bank when it is destroyed.
+     * 
+     * The table is split into stripes selected by the structural hash, each with its own buckets and mutex, so that
+     * the threads creating and releasing terms at the same time rarely wait for each other.
+     * 
+     * @tparam T The type of the head(data) of the term. std::hash<T> should be defined.
+     */
+    template <class T>
+    class TermBank {
+    private:
+        // One stripe of the table, on its own cache line.
+        struct alignas(64) Stripe {
+            std::vector<Term<T>*> buckets;
+            std::size_t count = 0;
+            std::size_t created_count = 0;
+            mutable std::mutex mtx;
+
+            void rehash(std::size_t bucket_num);
+        };
+
+        static constexpr std::size_t stripe_bits = 4;
+        static constexpr std::size_t stripe_num = 1 << stripe_bits;
+        static constexpr std::size_t init_bucket_num = 1 << 8;
+
+        std::array<Stripe, stripe_num> stripes;
+
+        // statistics: the number of living nodes over all stripes, and the maximum of it
+        std::atomic<std::size_t> live_count = 0;
+        std::atomic<std::size_t> peak_count = 0;
+
+        static bool node_match(const Term<T>& term, const T& head, std::span<const TermPtr<T>> args);
+
+        /**
+         * @brief The stripe of the hash. It is selected by the high bits, and the buckets in it by the low bits.
+         */
+        inline Stripe& stripe_of(std::size_t h) {
+            return stripes[(h >> (sizeof(std::size_t) * 8 - stripe_bits)) & (stripe_num - 1)];
+        }
+
+        friend class Term<T>;
+
+        /**
+         * @brief Remove the node from the bank. It is called by the destructor of interned terms.
+         */
+        void erase(Term<T>* term);
+
+    public:
+        TermBank();
+        TermBank(const TermBank&) = delete;
+        TermBank& operator = (const TermBank&) = delete;
+
+        /**
+         * @brief Get the global term bank for the head type T.
+         */
+        static TermBank<T>& get_instance();
+
+        /**
+         * @brief Get the unique term with the given head and arguments. The arguments are interned first if necessary.
+         */
+        TermPtr<T> get_term(const T& head, ListArgs<T>&& args);
+        TermPtr<T> get_term(const T& head, const ListArgs<T>& args);
+        TermPtr<T> get_term(const T& head);
+
+        /**
+         * @brief Get the interned representative of a term that may be constructed outside the bank.
+         */
+        TermPtr<T> intern(TermPtr<T> term);
+
+        /**
+         * @brief The number of living terms in the bank.
+         */
+        std::size_t size() const;
+
+        /**
+         * @brief The number of terms created by the bank, i.e., the number of term allocations.
+         */
+        std::size_t created_num() const;
+
+        /**
+         * @brief The maximum number of living terms since the last reset_peak_size().
+         */
+        std::size_t peak_size() const;
+
+        void reset_peak_size();
+    };
+
+    /**
+     * @brief Create a term through the global term bank.
+     */
+    template <class T>
+    inline TermPtr<T> make_term(const T& head, ListArgs<T>&& args) {
+        return TermBank<T>::get_instance().get_term(head, std::move(args));
+    }
+
+    template <class T>
+    inline TermPtr<T> make_term(const T& head) {
+        return TermBank<T>::get_instance().get_term(head);
+    }
+
+    /**
+     * @brief Create a term outside the term bank. The term is not interned, and can be interned by TermBank::intern.
+     */
+    template <class T, class... Args>
+    TermPtr<T> make_raw_term(const T& head, Args&&... args) {
+        TermAllocator<T> alloc;
+        auto node = alloc.allocate(1);
+        try {
+            std::construct_at(node, head, std::forward<Args>(args)...);
+        }
+        catch (...) {
+            alloc.deallocate(node, 1);
+            throw;
+        }
+        return TermPtr<T>(node);
+    }
+
 
     /////////////////////////////////////////////////////////////////
     // Implementations
@@ -83,18 +337,71 @@ namespace ualg {
     template <class T>
     Term<T>::Term(const T& head) {
         this->head = head;
+        init_structure_info();
     }
 
     template <class T>
-    Term<T>::Term(const T& head, const ListArgs<T>& args) {
-        this->head = head;
-        this->args = args;
+    Term<T>::Term(const T& head, const ListArgs<T>& args) : head(head), args(args) {
+        init_structure_info();
     }
 
     template <class T>
-    Term<T>::Term(const T& head, ListArgs<T>&& args) {
-        this->head = head;
-        this->args = std::move(args);
+    Term<T>::Term(const T& head, ListArgs<T>&& args) : head(head), args(std::move(args)) {
+        init_structure_info();
+    }
+
+    template <class T>
+    void Term<T>::init_structure_info() {
+        hash_value = calc_hash(head, args);
+        term_size = 1;
+        depth = 1;
+        head_mask = head_bit(head);
+        for (const auto& arg : args) {
+            term_size += arg->term_size;
+            depth = std::max(depth, arg->depth + 1);
+            head_mask |= arg->head_mask;
+        }
+    }
+
+    template <class T>
+    std::size_t Term<T>::calc_hash(const T& head, std::span<const TermPtr<T>> args) {
+        std::size_t h = std::hash<T>{}(head);
+        for (const auto& arg : args) {
+            h = combine_hash(h, arg->hash_value);
+        }
+        return h;
+    }
+
+    template <class T>
+    std::size_t Term<T>::combine_hash(std::size_t h, std::size_t arg_hash) {
+        return h ^ (arg_hash + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2));
+    }
+
+    template <class T>
+    void Term<T>::add_ref() const {
+        RefCount::increment(ref_counter);
+    }
+
+    template <class T>
+    void Term<T>::release() const {
+        if (RefCount::decrement(ref_counter)) {
+            auto node = const_cast<Term<T>*>(this);
+            TermAllocator<T> alloc;
+            std::destroy_at(node);
+            alloc.deallocate(node, 1);
+        }
+    }
+
+    template <class T>
+    std::size_t Term<T>::ref_count() const {
+        return RefCount::load(ref_counter);
+    }
+
+    template <class T>
+    Term<T>::~Term() {
+        if (interned) {
+            TermBank<T>::get_instance().erase(this);
+        }
     }
 
     template <class T>
@@ -103,12 +410,15 @@ namespace ualg {
     }
 
     template <class T>
-    const ListArgs<T>& Term<T>::get_args() const {
+    const TermArgs<T>& Term<T>::get_args() const {
         return this->args;
     }
 
     template <class T>
     COMPARE_TYPE Term<T>::compare(const Term<T>& other) const {
+        if (this == &other) {
+            return EQUAL;
+        }
         if (this->head != other.head) {
             return this->head < other.head ? LESS : GREATER;
         }
@@ -127,6 +437,17 @@ namespace ualg {
 
     template <class T>
     bool Term<T>::operator == (const Term<T>& other) const {
+        if (this == &other) {
+            return true;
+        }
+        // different interned terms are always structurally different
+        if (this->interned && other.interned) {
+            return false;
+        }
+        // fast rejection by the structural information
+        if (this->hash_value != other.hash_value || this->term_size != other.term_size) {
+            return false;
+        }
         return compare(other) == EQUAL;
     }
 
@@ -141,13 +462,35 @@ namespace ualg {
     }
 
 
+    template <class T>
+    std::size_t Term<T>::get_hash() const {
+        return hash_value;
+    }
+
     template <class T>
     std::size_t Term<T>::get_term_size() const {
-        std::size_t size = 1;
-        for (const auto& arg : args) {
-            size += arg->get_term_size();
-        }
-        return size;
+        return term_size;
+    }
+
+    template <class T>
+    std::size_t Term<T>::get_depth() const {
+        return depth;
+    }
+
+    template <class T>
+    std::uint64_t Term<T>::head_bit(const T& head) {
+        // Fibonacci hashing, so that the consecutive symbols spread over the bits
+        return std::uint64_t(1) << ((std::uint64_t(std::hash<T>{}(head)) * 0x9e3779b97f4a7c15ULL) >> 58);
+    }
+
+    template <class T>
+    std::uint64_t Term<T>::get_head_mask() const {
+        return head_mask;
+    }
+
+    template <class T>
+    bool Term<T>::may_contain(const T& head) const {
+        return (head_mask & head_bit(head)) != 0;
     }
 
     template <class T>
@@ -155,30 +498,43 @@ namespace ualg {
         return args.size() == 0;
     }
 
+    template <class T>
+    bool Term<T>::is_interned() const {
+        return interned;
+    }
+
 
     template <class T>
     std::string Term<T>::to_string(const std::map<T, std::string>* head_naming) const {
         std::string str;
+        append_to(str, head_naming);
+        return str;
+    }
+
+    template <class T>
+    void Term<T>::append_to(std::string& res, const std::map<T, std::string>* head_naming) const {
         if (head_naming != nullptr) {
-            str = head_naming->at(this->head);
+            res += head_naming->at(this->head);
         }
         else {
-            str = data_to_string(this->head);
+            res += data_to_string(this->head);
         }
         if (args.size() > 0) {
-            str += "[" + args[0]->to_string(head_naming);
-            for (int i = 1; i < args.size(); i++) {
-                str += ", " + args[i]->to_string(head_naming);
+            res += "[";
+            for (int i = 0; i < args.size(); i++) {
+                if (i > 0) {
+                    res += ", ";
+                }
+                args[i]->append_to(res, head_naming);
             }
-            str += "]";
+            res += "]";
         }
-        return str;
     }
 
     template <class T>
     TermPtr<T> Term<T>::get_subterm(const TermPos& pos) const {
         if (pos.size() == 0) {
-            return this->shared_from_this();
+            return TermPtr<T>(this);
         }
 
         if (pos[0] >= args.size()) {
@@ -198,34 +554,203 @@ namespace ualg {
         for (const auto& arg : args) {
             new_args.push_back(arg->replace_term(pattern, replacement));
         }
-        return std::make_shared<const Term<T>>(this->head, std::move(new_args));
+        return make_term(this->head, std::move(new_args));
     }
 
 
     template <class T>
     TermPtr<T> Term<T>::replace_at(const TermPos& pos, TermPtr<T> new_subterm) const {
 
-        if (pos.size() == 0) {
-            return new_subterm;
+        // the nodes on the path, kept alive by this term
+        std::vector<const Term<T>*> path;
+        auto node = this;
+        for (auto i : pos) {
+            if (i >= node->args.size()) {
+                throw std::runtime_error("Position out of range.");
+            }
+            path.push_back(node);
+            node = node->args[i].get();
         }
 
-        auto args = this->get_args();
+        // rebuild the path from the bottom
+        auto current = std::move(new_subterm);
+        for (int k = int(path.size()) - 1; k >= 0; k--) {
+            ListArgs<T> new_args(path[k]->args.begin(), path[k]->args.end());
+            new_args[pos[k]] = std::move(current);
+            current = make_term(path[k]->head, std::move(new_args));
+        }
+        return current;
+    }
 
-        ListArgs<T> new_args;
+    /**
+     * @brief Visit the subterms in preorder through borrowed references.
+     *
+     * @param term
+     * @param visitor The function called on each subterm. It returns whether the arguments of the subterm should be visited.
+     */
+    template <class T, class Visitor>
+    void visit_subterms(TermRef<T> term, Visitor&& visitor) {
+        if (!visitor(term)) {
+            return;
+        }
+        for (const auto& arg : term.get_args()) {
+            visit_subterms<T>(*arg, visitor);
+        }
+    }
+
+
+
+    ///////////////
+    // TermBank
+
+    template <class T>
+    bool TermBank<T>::node_match(const Term<T>& term, const T& head, std::span<const TermPtr<T>> args) {
+        if (term.head != head || term.args.size() != args.size()) {
+            return false;
+        }
         for (unsigned int i = 0; i < args.size(); i++) {
-            if (i == pos[0]) {
-                auto new_term = args[i]->replace_at(
-                    TermPos(pos.begin() + 1, pos.end()),
-                    new_subterm);
+            if (term.args[i] != args[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
 
-                new_args.push_back(new_term);
+    template <class T>
+    TermBank<T>::TermBank() {
+        for (auto& stripe : stripes) {
+            stripe.buckets.assign(init_bucket_num, nullptr);
+        }
+    }
+
+    template <class T>
+    void TermBank<T>::Stripe::rehash(std::size_t bucket_num) {
+        std::vector<Term<T>*> new_buckets(bucket_num, nullptr);
+        for (auto node : buckets) {
+            while (node != nullptr) {
+                auto next = node->bank_next;
+                auto& bucket = new_buckets[node->hash_value & (bucket_num - 1)];
+                node->bank_next = bucket;
+                bucket = node;
+                node = next;
             }
-            else {
-                new_args.push_back(args[i]);
+        }
+        buckets = std::move(new_buckets);
+    }
+
+    template <class T>
+    void TermBank<T>::erase(Term<T>* term) {
+        auto& stripe = stripe_of(term->hash_value);
+        std::lock_guard<std::mutex> lock(stripe.mtx);
+
+        auto link = &stripe.buckets[term->hash_value & (stripe.buckets.size() - 1)];
+        while (*link != nullptr) {
+            if (*link == term) {
+                *link = term->bank_next;
+                --stripe.count;
+                live_count.fetch_sub(1, std::memory_order_relaxed);
+                return;
             }
+            link = &(*link)->bank_next;
+        }
+    }
+
+    template <class T>
+    TermBank<T>& TermBank<T>::get_instance() {
+        // never destroyed, so that terms alive at exit can still remove themselves
+        static TermBank<T>* instance = new TermBank<T>();
+        return *instance;
+    }
+
+    template <class T>
+    TermPtr<T> TermBank<T>::get_term(const T& head, ListArgs<T>&& args) {
+        // the arguments should be interned so that they can be identified by their addresses
+        for (auto& arg : args) {
+            if (!arg->interned) {
+                arg = intern(arg);
+            }
+        }
+
+        auto h = Term<T>::calc_hash(head, args);
+
+        auto& stripe = stripe_of(h);
+        std::lock_guard<std::mutex> lock(stripe.mtx);
+
+        for (auto node = stripe.buckets[h & (stripe.buckets.size() - 1)]; node != nullptr; node = node->bank_next) {
+            if (node->hash_value == h && node_match(*node, head, args)) {
+                // the node can be in destruction by another thread, in which case a new one is created
+                if (Term<T>::RefCount::try_increment(node->ref_counter)) {
+                    return TermPtr<T>::adopt(node);
+                }
+            }
+        }
+
+        if (stripe.count >= stripe.buckets.size()) {
+            stripe.rehash(2 * stripe.buckets.size());
+        }
+
+        auto term = make_raw_term(head, std::move(args));
+        auto node = const_cast<Term<T>*>(term.get());
+        node->interned = true;
+
+        auto& bucket = stripe.buckets[h & (stripe.buckets.size() - 1)];
+        node->bank_next = bucket;
+        bucket = node;
+        ++stripe.count;
+        ++stripe.created_count;
+
+        auto live = live_count.fetch_add(1, std::memory_order_relaxed) + 1;
+        auto peak = peak_count.load(std::memory_order_relaxed);
+        while (live > peak && !peak_count.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+
+        return term;
+    }
+    template <class T>
+    TermPtr<T> TermBank<T>::get_term(const T& head, const ListArgs<T>& args) {
+        return get_term(head, ListArgs<T>(args));
+    }
+
+    template <class T>
+    TermPtr<T> TermBank<T>::get_term(const T& head) {
+        return get_term(head, ListArgs<T>());
+    }
+
+    template <class T>
+    TermPtr<T> TermBank<T>::intern(TermPtr<T> term) {
+        if (term->interned) {
+            return term;
         }
-        return std::make_shared<const Term<T>>(this->head, std::move(new_args));
+        return get_term(term->head, term->args.to_vector());
     }
 
+    template <class T>
+    std::size_t TermBank<T>::size() const {
+        std::size_t res = 0;
+        for (const auto& stripe : stripes) {
+            std::lock_guard<std::mutex> lock(stripe.mtx);
+            res += stripe.count;
+        }
+        return res;
+    }
+
+    template <class T>
+    std::size_t TermBank<T>::created_num() const {
+        std::size_t res = 0;
+        for (const auto& stripe : stripes) {
+            std::lock_guard<std::mutex> lock(stripe.mtx);
+            res += stripe.created_count;
+        }
+        return res;
+    }
+
+    template <class T>
+    std::size_t TermBank<T>::peak_size() const {
+        return peak_count.load(std::memory_order_relaxed);
+    }
+
+    template <class T>
+    void TermBank<T>::reset_peak_size() {
+        peak_count.store(live_count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
 
 }   // namespace ualg
\ No newline at end of file
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <span>
+#include <vector>
+
+namespace ualg {
+
+    /**
+     * @brief The argument list stored in a term.
+     *
+     * Up to `inline_capacity` arguments are stored inside the object, and only longer lists (e.g., flattened AC terms)
+     * are allocated on the heap. The list has a fixed length once constructed. It provides the read interface of
+     * std::vector, and converts to a `std::vector` or a `std::span` when needed.
+     *
+     * @tparam E The type of the elements.
+     */
+    template <class E>
+    class SmallArgs {
+    public:
+        static constexpr std::size_t inline_capacity = 3;
+
+        using value_type = E;
+        using size_type = std::size_t;
+        using iterator = E*;
+        using const_iterator = const E*;
+
+    private:
+        E* elements;
+        size_type count = 0;
+        alignas(E) unsigned char storage[inline_capacity * sizeof(E)];
+
+        inline E* inline_elements() {
+            return std::launder(reinterpret_cast<E*>(storage));
+        }
+
+        inline bool is_inline() const {
+            return elements == reinterpret_cast<const E*>(storage);
+        }
+
+        /**
+         * @brief Prepare the uninitialized space for n elements.
+         */
+        inline E* reserve_space(size_type n) {
+            count = n;
+            if (n <= inline_capacity) {
+                elements = reinterpret_cast<E*>(storage);
+            }
+            else {
+                elements = static_cast<E*>(::operator new(n * sizeof(E)));
+            }
+            return elements;
+        }
+
+        inline void release() {
+            std::destroy_n(elements, count);
+            if (!is_inline()) {
+                ::operator delete(elements);
+            }
+            elements = reinterpret_cast<E*>(storage);
+            count = 0;
+        }
+
+        template <class It>
+        inline void init_copy(It first, It last) {
+            std::uninitialized_copy(first, last, reserve_space(std::distance(first, last)));
+        }
+
+        inline void init_move(SmallArgs&& other) {
+            if (other.is_inline()) {
+                std::uninitialized_move_n(other.elements, other.count, reserve_space(other.count));
+                other.release();
+            }
+            else {
+                elements = other.elements;
+                count = other.count;
+                other.elements = reinterpret_cast<E*>(other.storage);
+                other.count = 0;
+            }
+        }
+
+    public:
+        SmallArgs() : elements(reinterpret_cast<E*>(storage)) {}
+
+        SmallArgs(std::vector<E>&& list) {
+            std::uninitialized_move(list.begin(), list.end(), reserve_space(list.size()));
+            list.clear();
+        }
+
+        SmallArgs(const std::vector<E>& list) {
+            init_copy(list.begin(), list.end());
+        }
+
+        SmallArgs(std::initializer_list<E> list) {
+            init_copy(list.begin(), list.end());
+        }
+
+        template <class It>
+        SmallArgs(It first, It last) {
+            init_copy(first, last);
+        }
+
+        SmallArgs(const SmallArgs& other) {
+            init_copy(other.begin(), other.end());
+        }
+
+        SmallArgs(SmallArgs&& other) noexcept {
+            init_move(std::move(other));
+        }
+
+        SmallArgs& operator = (const SmallArgs& other) {
+            if (this != &other) {
+                release();
+                init_copy(other.begin(), other.end());
+            }
+            return *this;
+        }
+
+        SmallArgs& operator = (SmallArgs&& other) noexcept {
+            if (this != &other) {
+                release();
+                init_move(std::move(other));
+            }
+            return *this;
+        }
+
+        ~SmallArgs() {
+            release();
+        }
+
+        inline size_type size() const {
+            return count;
+        }
+
+        inline bool empty() const {
+            return count == 0;
+        }
+
+        inline const E& operator [] (size_type i) const {
+            return elements[i];
+        }
+
+        inline E& operator [] (size_type i) {
+            return elements[i];
+        }
+
+        inline const E* data() const {
+            return elements;
+        }
+
+        inline const_iterator begin() const {
+            return elements;
+        }
+
+        inline const_iterator end() const {
+            return elements + count;
+        }
+
+        inline iterator begin() {
+            return elements;
+        }
+
+        inline iterator end() {
+            return elements + count;
+        }
+
+        inline const E& front() const {
+            return elements[0];
+        }
+
+        inline const E& back() const {
+            return elements[count - 1];
+        }
+
+        inline std::span<const E> as_span() const {
+            return {elements, count};
+        }
+
+        inline operator std::span<const E>() const {
+            return as_span();
+        }
+
+        inline std::vector<E> to_vector() const {
+            return std::vector<E>(begin(), end());
+        }
+
+        inline operator std::vector<E>() const {
+            return to_vector();
+        }
+
+        inline bool operator == (const SmallArgs& other) const {
+            return std::equal(begin(), end(), other.begin(), other.end());
+        }
+    };
+
+}   // namespace ualg
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <stdexcept>
+#include <vector>
+
+#include "term.hpp"
+
+namespace ualg {
+
+    /**
+     * @brief The cursor (zipper) pointing to a subterm of a root term.
+     *
+     * The cursor records the path of the parent nodes while moving down, so that moving up is free and replacing the
+     * subterm under the cursor rebuilds the spine to the root once. The nodes on the path are kept alive by the root.
+     *
+     * @tparam T The type of the head(data) of the term.
+     */
+    template <class T>
+    class TermCursor {
+    protected:
+        struct Frame {
+            const Term<T>* parent;
+            unsigned int index;
+        };
+
+        TermPtr<T> root;
+        const TermPtr<T>* focus;
+        std::vector<Frame> path;
+
+    public:
+        TermCursor(TermPtr<T> root) : root(std::move(root)), focus(&this->root) {}
+
+        TermCursor(const TermCursor&) = delete;
+        TermCursor& operator = (const TermCursor&) = delete;
+
+        /**
+         * @brief The subterm under the cursor.
+         */
+        inline const TermPtr<T>& get_focus() const {
+            return *focus;
+        }
+
+        inline const TermPtr<T>& get_root() const {
+            return root;
+        }
+
+        inline bool is_root() const {
+            return path.empty();
+        }
+
+        inline std::size_t get_depth() const {
+            return path.size();
+        }
+
+        /**
+         * @brief Move to the i-th argument of the subterm under the cursor.
+         */
+        inline void down(unsigned int i) {
+            auto& parent = **focus;
+            if (i >= parent.get_args().size()) {
+                throw std::runtime_error("Position out of range.");
+            }
+            path.push_back(Frame{&parent, i});
+            focus = &parent.get_args()[i];
+        }
+
+        /**
+         * @brief Move to the parent of the subterm under the cursor.
+         */
+        inline void up() {
+            path.pop_back();
+            focus = path.empty() ? &root : &path.back().parent->get_args()[path.back().index];
+        }
+
+        /**
+         * @brief The position of the subterm under the cursor in the root term.
+         */
+        TermPos get_pos() const {
+            TermPos pos;
+            pos.reserve(path.size());
+            for (const auto& frame : path) {
+                pos.push_back(frame.index);
+            }
+            return pos;
+        }
+
+        /**
+         * @brief Replace the subterm under the cursor, and return the new root term. Only the nodes on the path are
+         * rebuilt. The cursor is not changed.
+         */
+        TermPtr<T> replace(TermPtr<T> new_subterm) const {
+            auto current = std::move(new_subterm);
+            for (auto it = path.rbegin(); it != path.rend(); ++it) {
+                auto& args = it->parent->get_args();
+                ListArgs<T> new_args(args.begin(), args.end());
+                new_args[it->index] = std::move(current);
+                current = make_term(it->parent->get_head(), std::move(new_args));
+            }
+            return current;
+        }
+    };
+
+}   // namespace ualg
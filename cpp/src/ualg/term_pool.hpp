@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Set UALG_TERM_POOL to 0 to allocate the term nodes with the standard allocator.
+#ifndef UALG_TERM_POOL
+#define UALG_TERM_POOL 1
+#endif
+
+namespace ualg {
+
+    /**
+     * @brief The pool of memory blocks of one size class.
+     *
+     * The blocks are cut from large chunks and recycled through free lists. Every thread keeps its own free list, so
+     * that allocation and deallocation need no locking. A block can be released by another thread than the one that
+     * allocated it, and the free blocks of an exiting thread are handed over to a global list.
+     *
+     * The chunks are never returned to the system, which is intended. The pool is shared by all objects of the size
+     * class and has no owner to free it, and the term bank is never destroyed either, so that the terms still alive
+     * at exit can release their nodes. The memory is bounded by the peak number of live blocks, and it is reused by
+     * the later allocations of the same size class.
+     *
+     * @tparam BlockSize The size of the blocks. It should be a multiple of the alignment of std::max_align_t.
+     */
+    template <std::size_t BlockSize>
+    class BlockPool {
+    private:
+        struct FreeBlock {
+            FreeBlock* next;
+        };
+
+        static_assert(BlockSize >= sizeof(FreeBlock) && BlockSize % alignof(std::max_align_t) == 0);
+
+        static constexpr std::size_t chunk_block_num = 1024;
+
+        // The free list of the current thread. The variables are trivial, so that they are still usable when
+        // objects are released during the destruction of other thread-local or static objects.
+        static inline thread_local FreeBlock* local_free = nullptr;
+        static inline thread_local bool local_exited = false;
+
+        // The global free list, receiving the blocks of the exited threads.
+        static inline std::mutex global_mtx;
+        static inline FreeBlock* global_free = nullptr;
+
+        struct LocalFlusher {
+            ~LocalFlusher() {
+                std::lock_guard<std::mutex> lock(global_mtx);
+                while (local_free != nullptr) {
+                    auto next = local_free->next;
+                    local_free->next = global_free;
+                    global_free = local_free;
+                    local_free = next;
+                }
+                local_exited = true;
+            }
+        };
+
+        /**
+         * @brief Register the flusher of the current thread, on its first use of the pool, whether it allocates or
+         * only releases blocks.
+         */
+        static void register_flusher() {
+            thread_local LocalFlusher flusher;
+        }
+
+        /**
+         * @brief Refill the local free list, from the global list if possible, and otherwise from a new chunk.
+         */
+        static void refill() {
+            {
+                std::lock_guard<std::mutex> lock(global_mtx);
+                if (global_free != nullptr) {
+                    local_free = global_free;
+                    global_free = nullptr;
+                    return;
+                }
+            }
+
+            auto chunk = static_cast<char*>(::operator new(BlockSize * chunk_block_num));
+            for (std::size_t i = 0; i < chunk_block_num; i++) {
+                auto block = reinterpret_cast<FreeBlock*>(chunk + i * BlockSize);
+                block->next = local_free;
+                local_free = block;
+            }
+        }
+
+    public:
+        static void* allocate() {
+            if (local_exited) {
+                return ::operator new(BlockSize);
+            }
+
+            register_flusher();
+            if (local_free == nullptr) {
+                refill();
+            }
+            auto block = local_free;
+            local_free = block->next;
+            return block;
+        }
+
+        static void deallocate(void* p) {
+            auto block = static_cast<FreeBlock*>(p);
+            if (local_exited) {
+                std::lock_guard<std::mutex> lock(global_mtx);
+                block->next = global_free;
+                global_free = block;
+                return;
+            }
+
+            register_flusher();
+            block->next = local_free;
+            local_free = block;
+        }
+    };
+
+    /**
+     * @brief The allocator using the size-class pools for single objects. Arrays are allocated by operator new.
+     */
+    template <class U>
+    class PoolAllocator {
+    private:
+        static constexpr std::size_t align = alignof(std::max_align_t);
+        static constexpr std::size_t block_size = (sizeof(U) + align - 1) / align * align;
+        static constexpr bool pooled = alignof(U) <= align;
+
+    public:
+        using value_type = U;
+
+        PoolAllocator() noexcept = default;
+
+        template <class V>
+        PoolAllocator(const PoolAllocator<V>&) noexcept {}
+
+        U* allocate(std::size_t n) {
+            if constexpr (pooled) {
+                if (n == 1) {
+                    return static_cast<U*>(BlockPool<block_size>::allocate());
+                }
+            }
+            return static_cast<U*>(::operator new(n * sizeof(U), std::align_val_t(alignof(U))));
+        }
+
+        void deallocate(U* p, std::size_t n) {
+            if constexpr (pooled) {
+                if (n == 1) {
+                    BlockPool<block_size>::deallocate(p);
+                    return;
+                }
+            }
+            ::operator delete(p, std::align_val_t(alignof(U)));
+        }
+
+        template <class V>
+        bool operator == (const PoolAllocator<V>&) const noexcept {
+            return true;
+        }
+
+        template <class V>
+        bool operator != (const PoolAllocator<V>&) const noexcept {
+            return false;
+        }
+    };
+
+}   // namespace ualg
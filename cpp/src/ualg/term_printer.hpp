@@ -0,0 +1,216 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "term.hpp"
+
+namespace ualg {
+
+    /**
+     * @brief The options of printing terms. The default options print the whole term.
+     */
+    struct PrintOptions {
+        // The subterms at this depth and below are printed as "...". 0 means no limit.
+        std::size_t max_depth = 0;
+
+        // Only the first max_width arguments of a term are printed, and the other k arguments are printed as "...(+k)".
+        // 0 means no limit.
+        std::size_t max_width = 0;
+
+        // Whether the shared subterms are printed only once. They are defined by the labels "#k" in the let-style
+        // header "let #0 = ...; #1 = ... in ", and the later occurrences refer to the labels.
+        bool share = false;
+    };
+
+    /**
+     * @brief The printer of terms. It writes into a string buffer in one pass, and hands the buffer over to the output
+     * stream whenever it is large enough, so that the memory does not grow with the size of the output.
+     *
+     * @tparam AppendName The function appending the name of a head to a string, as void(const T&, std::string&).
+     */
+    template <class T, class AppendName>
+    class TermPrinter {
+    protected:
+        const AppendName& append_name;
+        const PrintOptions& options;
+        std::string& buffer;
+        std::ostream* os;
+
+        // The labels of the shared subterms.
+        std::unordered_map<const Term<T>*, std::size_t> labels;
+
+        // The smallest depth at which the compound subterms are printed, in the share mode.
+        std::unordered_map<const Term<T>*, std::size_t> min_depths;
+
+        static constexpr std::size_t flush_size = 1 << 16;
+
+        inline void _flush_if_full() {
+            if (os != nullptr && buffer.size() >= flush_size) {
+                os->write(buffer.data(), buffer.size());
+                buffer.clear();
+            }
+        }
+
+        inline std::size_t _width(const ListArgs<T>& args) const {
+            return options.max_width == 0 ? args.size() : std::min<std::size_t>(args.size(), options.max_width);
+        }
+
+        inline bool _elided(TermRef<T> term, std::size_t depth) const {
+            return options.max_depth != 0 && depth >= options.max_depth && !term.is_atomic();
+        }
+
+        /**
+         * @brief Find the compound subterms in the region of the term that is printed, i.e., the first max_width
+         * arguments above max_depth, together with the smallest depth at which they occur. A subterm is explored
+         * again when it is reached at a smaller depth, because more of it is printed there.
+         */
+        void _explore(TermRef<T> term, std::size_t depth) {
+            if (term.is_atomic() || _elided(term, depth)) {
+                return;
+            }
+            auto [find, inserted] = min_depths.try_emplace(&term, depth);
+            if (!inserted) {
+                if (find->second <= depth) {
+                    return;
+                }
+                find->second = depth;
+            }
+
+            const auto& args = term.get_args();
+            for (std::size_t i = 0; i < _width(args); i++) {
+                _explore(*args[i], depth + 1);
+            }
+        }
+
+        /**
+         * @brief Count the references to the explored subterms from the printed region, i.e., every explored subterm is
+         * visited once. The subterms are collected in postorder.
+         */
+        void _count_refs(TermRef<T> term, std::unordered_map<const Term<T>*, std::size_t>& refs, std::vector<const Term<T>*>& postorder) {
+            if (refs[&term]++ > 0) {
+                return;
+            }
+            // the subterm is printed at its smallest depth, and so are the children of it
+            auto depth = min_depths[&term] + 1;
+            const auto& args = term.get_args();
+            for (std::size_t i = 0; i < _width(args); i++) {
+                if (!args[i]->is_atomic() && !_elided(*args[i], depth)) {
+                    _count_refs(*args[i], refs, postorder);
+                }
+            }
+            postorder.push_back(&term);
+        }
+
+        void _print(TermRef<T> term, std::size_t depth, bool is_root) {
+            if (_elided(term, depth)) {
+                buffer += "...";
+                return;
+            }
+
+            if (!is_root && !labels.empty()) {
+                auto find = labels.find(&term);
+                if (find != labels.end()) {
+                    buffer += "#";
+                    buffer += std::to_string(find->second);
+                    return;
+                }
+            }
+
+            const auto& args = term.get_args();
+
+            append_name(term.get_head(), buffer);
+            _flush_if_full();
+
+            if (args.size() > 0) {
+                auto width = _width(args);
+                buffer += "[";
+                for (std::size_t i = 0; i < width; i++) {
+                    if (i > 0) {
+                        buffer += ", ";
+                    }
+                    _print(*args[i], depth + 1, false);
+                }
+                if (width < args.size()) {
+                    buffer += ", ...(+";
+                    buffer += std::to_string(args.size() - width);
+                    buffer += ")";
+                }
+                buffer += "]";
+            }
+        }
+
+    public:
+        TermPrinter(const AppendName& append_name, const PrintOptions& options, std::string& buffer, std::ostream* os = nullptr) :
+            append_name(append_name), options(options), buffer(buffer), os(os) {}
+
+        void print(TermRef<T> term) {
+            labels.clear();
+            min_depths.clear();
+
+            if (options.share) {
+                // only the references that are actually printed are counted, not the ones in the elided parts
+                _explore(term, 0);
+
+                std::unordered_map<const Term<T>*, std::size_t> refs;
+                std::vector<const Term<T>*> postorder;
+                if (!term.is_atomic()) {
+                    _count_refs(term, refs, postorder);
+                }
+
+                // label in postorder, so that the labels are defined before they are referred to
+                std::vector<const Term<T>*> shared;
+                for (auto subterm : postorder) {
+                    if (refs[subterm] > 1) {
+                        labels[subterm] = shared.size();
+                        shared.push_back(subterm);
+                    }
+                }
+
+                if (!shared.empty()) {
+                    buffer += "let ";
+                    for (std::size_t i = 0; i < shared.size(); i++) {
+                        if (i > 0) {
+                            buffer += "; ";
+                        }
+                        buffer += "#";
+                        buffer += std::to_string(i);
+                        buffer += " = ";
+                        // elided as at the shallowest occurrence, whose children are the explored ones
+                        _print(*shared[i], min_depths[shared[i]], true);
+                    }
+                    buffer += " in ";
+                }
+            }
+
+            _print(term, 0, true);
+
+            if (os != nullptr) {
+                os->write(buffer.data(), buffer.size());
+                buffer.clear();
+            }
+        }
+    };
+
+    /**
+     * @brief Append the term to the string.
+     */
+    template <class T, class AppendName>
+    void print_term(std::string& res, TermRef<T> term, const AppendName& append_name, const PrintOptions& options = {}) {
+        TermPrinter<T, AppendName>(append_name, options, res).print(term);
+    }
+
+    /**
+     * @brief Write the term to the output stream, through a bounded buffer.
+     */
+    template <class T, class AppendName>
+    void print_term(std::ostream& os, TermRef<T> term, const AppendName& append_name, const PrintOptions& options = {}) {
+        std::string buffer;
+        TermPrinter<T, AppendName>(append_name, options, buffer, &os).print(term);
+    }
+
+} // namespace ualg
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <atomic>
+#include <compare>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+// Set UALG_TERM_ATOMIC_REFCOUNT to 0 to count the references of terms without atomic operations. The terms can then
+// only be used by one thread.
+#ifndef UALG_TERM_ATOMIC_REFCOUNT
+#define UALG_TERM_ATOMIC_REFCOUNT 1
+#endif
+
+namespace ualg {
+
+    /**
+     * @brief The reference counting policy with atomic counters. The objects can be shared across threads.
+     */
+    struct AtomicRefCount {
+        using counter_type = std::atomic<std::size_t>;
+
+        static constexpr bool thread_safe = true;
+
+        static inline void increment(counter_type& counter) {
+            counter.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Increment the counter only if it is not zero, i.e., the object is not in destruction.
+         */
+        static inline bool try_increment(counter_type& counter) {
+            auto n = counter.load(std::memory_order_relaxed);
+            while (n != 0) {
+                if (counter.compare_exchange_weak(n, n + 1, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * @brief Decrement the counter, and return whether it reaches zero.
+         */
+        static inline bool decrement(counter_type& counter) {
+            return counter.fetch_sub(1, std::memory_order_acq_rel) == 1;
+        }
+
+        static inline std::size_t load(const counter_type& counter) {
+            return counter.load(std::memory_order_relaxed);
+        }
+    };
+
+    /**
+     * @brief The reference counting policy with plain counters. The objects can only be used by one thread.
+     */
+    struct PlainRefCount {
+        using counter_type = std::size_t;
+
+        static constexpr bool thread_safe = false;
+
+        static inline void increment(counter_type& counter) {
+            ++counter;
+        }
+
+        static inline bool try_increment(counter_type& counter) {
+            if (counter == 0) {
+                return false;
+            }
+            ++counter;
+            return true;
+        }
+
+        static inline bool decrement(counter_type& counter) {
+            return --counter == 0;
+        }
+
+        static inline std::size_t load(const counter_type& counter) {
+            return counter;
+        }
+    };
+
+    using DefaultRefCount = std::conditional_t<UALG_TERM_ATOMIC_REFCOUNT, AtomicRefCount, PlainRefCount>;
+
+    /**
+     * @brief The smart pointer to the objects with intrusive reference counters.
+     *
+     * The object should provide `add_ref()` and `release()`, where `release()` destroys the object when the last
+     * reference is dropped, and `ref_count()`. A pointer can be created from any object managed in this way, e.g.,
+     * from `this`.
+     *
+     * @tparam U The type of the object.
+     */
+    template <class U>
+    class IntrusivePtr {
+    private:
+        U* ptr = nullptr;
+
+    public:
+        using element_type = U;
+
+        IntrusivePtr() noexcept = default;
+
+        IntrusivePtr(std::nullptr_t) noexcept {}
+
+        explicit IntrusivePtr(U* ptr) noexcept : ptr(ptr) {
+            if (ptr != nullptr) {
+                ptr->add_ref();
+            }
+        }
+
+        IntrusivePtr(const IntrusivePtr& other) noexcept : IntrusivePtr(other.ptr) {}
+
+        IntrusivePtr(IntrusivePtr&& other) noexcept : ptr(std::exchange(other.ptr, nullptr)) {}
+
+        IntrusivePtr& operator = (const IntrusivePtr& other) noexcept {
+            IntrusivePtr(other).swap(*this);
+            return *this;
+        }
+
+        IntrusivePtr& operator = (IntrusivePtr&& other) noexcept {
+            IntrusivePtr(std::move(other)).swap(*this);
+            return *this;
+        }
+
+        ~IntrusivePtr() {
+            if (ptr != nullptr) {
+                ptr->release();
+            }
+        }
+
+        /**
+         * @brief Take over a reference that is already counted.
+         */
+        static IntrusivePtr adopt(U* ptr) noexcept {
+            IntrusivePtr res;
+            res.ptr = ptr;
+            return res;
+        }
+
+        inline void swap(IntrusivePtr& other) noexcept {
+            std::swap(ptr, other.ptr);
+        }
+
+        inline void reset() noexcept {
+            IntrusivePtr().swap(*this);
+        }
+
+        inline U* get() const noexcept {
+            return ptr;
+        }
+
+        inline U& operator * () const noexcept {
+            return *ptr;
+        }
+
+        inline U* operator -> () const noexcept {
+            return ptr;
+        }
+
+        inline explicit operator bool () const noexcept {
+            return ptr != nullptr;
+        }
+
+        inline std::size_t use_count() const noexcept {
+            return ptr == nullptr ? 0 : ptr->ref_count();
+        }
+
+        friend inline bool operator == (const IntrusivePtr& a, const IntrusivePtr& b) noexcept {
+            return a.ptr == b.ptr;
+        }
+
+        friend inline bool operator == (const IntrusivePtr& a, std::nullptr_t) noexcept {
+            return a.ptr == nullptr;
+        }
+
+        friend inline std::strong_ordering operator <=> (const IntrusivePtr& a, const IntrusivePtr& b) noexcept {
+            return std::compare_three_way{}(a.ptr, b.ptr);
+        }
+    };
+
+}   // namespace ualg
+
+template <class U>
+struct std::hash<ualg::IntrusivePtr<U>> {
+    std::size_t operator()(const ualg::IntrusivePtr<U>& ptr) const noexcept {
+        return std::hash<U*>{}(ptr.get());
+    }
+};
@@ -14,6 +14,8 @@
 #include <map>
 
 #include "term.hpp"
+#include "term_cursor.hpp"
 #include "AC_by_vec.hpp"
+#include "term_printer.hpp"
 #include "ualgparser.hpp"
 #include "rewrite.hpp"
\ No newline at end of file
@@ -1,4 +1,12 @@
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+
 #include "term.hpp"
+#include "symbol_table.hpp"
+#include "term_printer.hpp"
 #include "astparser.hpp"
 
 // Transform code, or AST, to terms in the bank
@@ -10,84 +18,173 @@ namespace ualg {
     protected:
         long long unique_var_id = 0;
 
-        // The mapping from inner representations to head names
-        std::map<T, std::string> head2name;
+        // The number of fresh variables in use. The fresh variable k is the id fresh_var_base + k, and it is named
+        // lazily by fresh_var_prefix + k, so that the fresh variables are never stored in the symbol table.
+        long long fresh_var_num = 0;
 
-        // The mapping from head names to inner representations
-        std::map<std::string, T> name2head;
+        // The mapping between head names and inner representations
+        SymbolTable<T> symbols;
 
     public:
-        Signature(std::map<std::string, T> name2head) : name2head(name2head) {
+        Signature(const std::map<std::string, T>& name2head) {
             for (const auto& [name, head] : name2head) {
-                head2name[head] = name;
+                symbols.add(name, head);
             }
         }
 
         // copy constructor
         Signature(const Signature& other) {
             // deep copy the mappings
-            head2name = other.head2name;
-            name2head = other.name2head;
+            symbols = other.symbols;
+            // continue the unique variables, so that the copy does not reuse the names of the original
+            unique_var_id = other.unique_var_id;
+            fresh_var_num = other.fresh_var_num;
         }
 
+        // The first id of the fresh variables. The registered symbols have smaller ids.
+        static constexpr int fresh_var_base = 1 << 30;
+
+        // The prefix of the names of the fresh variables.
+        static constexpr std::string_view fresh_var_prefix = "$v";
+
         inline std::string unique_var() {
             return "$" + std::to_string(unique_var_id++);
         }
 
-        inline T register_symbol(const std::string& name) {
-            auto find = name2head.find(name);
+        /**
+         * @brief Return a fresh variable. It is taken from the reserved id range, and does not grow the mappings.
+         */
+        inline T fresh_var() {
+            if constexpr(std::is_same_v<T, int>) {
+                if (fresh_var_num >= std::numeric_limits<int>::max() - fresh_var_base) {
+                    throw std::runtime_error("The fresh variables are exhausted.");
+                }
+                return fresh_var_base + static_cast<int>(fresh_var_num++);
+            }
+            else {
+                return register_symbol(unique_var());
+            }
+        }
+
+        inline bool is_fresh_var(const T& head) const {
+            if constexpr(std::is_same_v<T, int>) {
+                return head >= fresh_var_base;
+            }
+            else {
+                return false;
+            }
+        }
+
+        /**
+         * @brief Return the mark of the fresh variables in use, for reclaim_fresh_vars.
+         */
+        inline long long get_fresh_var_mark() const {
+            return fresh_var_num;
+        }
+
+        /**
+         * @brief Reclaim the fresh variables created after the mark, so that their ids are reused by fresh_var. The terms
+         * containing them should not be used together with the later fresh variables.
+         */
+        inline void reclaim_fresh_vars(long long mark) {
+            if (mark < fresh_var_num) {
+                fresh_var_num = mark;
+            }
+        }
 
-            if (find == name2head.end()) {
+        /**
+         * @brief Continue the fresh variables from the mark, e.g., of another signature whose terms are used with the
+         * later fresh variables of this one.
+         */
+        inline void continue_fresh_vars(long long mark) {
+            fresh_var_num = std::max(fresh_var_num, mark);
+        }
+
+        inline T register_symbol(std::string_view name) {
+            auto find = symbols.find_head(name);
+
+            if (!find.has_value()) {
                 if constexpr(std::is_same_v<T, int>) {
-                    int repr = head2name.size();
+                    auto fresh = _parse_fresh_var(name);
+                    if (fresh.has_value()) {
+                        // the later fresh variables should not collide with it
+                        fresh_var_num = std::max(fresh_var_num, static_cast<long long>(fresh.value() - fresh_var_base) + 1);
+                        return fresh.value();
+                    }
+
+                    int repr = symbols.size();
                     add_symbol(name, repr);
                     return repr;
                 }
                 else if constexpr(std::is_same_v<T, std::string>) {
-                    std::string repr = name;
+                    std::string repr(name);
                     add_symbol(name, repr);
                     return repr;
                 }
                 else {
-                    throw std::runtime_error("Unimplemented error for symbol: " + name);
+                    throw std::runtime_error("Unimplemented error for symbol: " + std::string(name));
                 }
             }
 
-            return find->second;
+            return find.value();
         }
 
-        inline std::optional<T> find_repr(const std::string& name) const {
-            auto find = name2head.find(name);
-            if (find == name2head.end()) {
-                return std::nullopt;
+        inline std::optional<T> find_repr(std::string_view name) const {
+            auto find = symbols.find_head(name);
+            if (!find.has_value()) {
+                return _parse_fresh_var(name);
             }
-            return find->second;
+            return find;
         }
 
-        inline T get_repr(const std::string& name) const {
-            return name2head.at(name);
+        inline T get_repr(std::string_view name) const {
+            auto find = find_repr(name);
+            if (!find.has_value()) {
+                throw std::out_of_range("The symbol '" + std::string(name) + "' is not in the signature.");
+            }
+            return find.value();
         }
 
         inline std::optional<std::string> find_name(const T& head) const {
-            auto find = head2name.find(head);
-            if (find == head2name.end()) {
+            if (is_fresh_var(head)) {
+                return _fresh_var_name(head);
+            }
+            auto find = symbols.find_name(head);
+            if (find == nullptr) {
                 return std::nullopt;
             }
-            return find->second;
+            return *find;
         }
 
         inline std::string get_name(const T& head) const {
-            return head2name.at(head);
+            std::string res;
+            _append_name(head, res);
+            return res;
+        }
+
+        /**
+         * @brief Return the number of the registered symbols. The fresh variables are not counted.
+         */
+        inline std::size_t get_symbol_num() const {
+            return symbols.size();
         }
 
         // Add a symbol to the signature
-        inline void add_symbol(const std::string& name, const T& head) {
-            name2head[name] = head;
-            head2name[head] = name;
+        inline void add_symbol(std::string_view name, const T& head) {
+            symbols.add(name, head);
+        }
+
+        inline std::string term_to_string(TermPtr<T> term, const PrintOptions& options = {}) const {
+            std::string res;
+            ualg::print_term(res, *term, _name_appender(), options);
+            return res;
         }
 
-        inline std::string term_to_string(TermPtr<T> term) const {
-            return term->to_string(&head2name);
+        /**
+         * @brief Write the term to the output stream, without building the whole string first.
+         */
+        inline void print_term(std::ostream& os, TermPtr<T> term, const PrintOptions& options = {}) const {
+            ualg::print_term(os, *term, _name_appender(), options);
         }
 
         astparser::AST term2ast(TermPtr<T> term) const;
@@ -95,6 +192,40 @@ namespace ualg {
         TermPtr<T> ast2term(const astparser::AST& ast);
 
         TermPtr<T> parse(const std::string& code);
+
+    protected:
+        inline std::string _fresh_var_name(const T& head) const {
+            if constexpr(std::is_same_v<T, int>) {
+                return std::string(fresh_var_prefix) + std::to_string(head - fresh_var_base);
+            }
+            else {
+                return data_to_string(head);
+            }
+        }
+
+        /**
+         * @brief Append the name of the head to `res`. Throw std::out_of_range if the head is not in the signature.
+         */
+        inline void _append_name(const T& head, std::string& res) const {
+            if (is_fresh_var(head)) {
+                res += _fresh_var_name(head);
+                return;
+            }
+            auto find = symbols.find_name(head);
+            if (find == nullptr) {
+                throw std::out_of_range("The head '" + data_to_string(head) + "' is not in the signature.");
+            }
+            res += *find;
+        }
+
+        /**
+         * @brief Return the fresh variable named by `name`, or std::nullopt if it is not the name of a fresh variable.
+         */
+        std::optional<T> _parse_fresh_var(std::string_view name) const;
+
+        inline auto _name_appender() const {
+            return [this](const T& head, std::string& res) { _append_name(head, res); };
+        }
     };
 
 
@@ -109,27 +240,55 @@ namespace ualg {
     //////////////////////////////////////////////////////////
     // Implementation
 
+    template <class T>
+    std::optional<T> Signature<T>::_parse_fresh_var(std::string_view name) const {
+        if constexpr(std::is_same_v<T, int>) {
+            auto prefix_len = fresh_var_prefix.size();
+            if (name.size() <= prefix_len || name.compare(0, prefix_len, fresh_var_prefix) != 0) {
+                return std::nullopt;
+            }
+            // only the canonical decimal numbers, so that the naming is one-to-one
+            if (name[prefix_len] == '0' && name.size() > prefix_len + 1) {
+                return std::nullopt;
+            }
+            long long k = 0;
+            for (auto i = prefix_len; i < name.size(); ++i) {
+                if (name[i] < '0' || name[i] > '9') {
+                    return std::nullopt;
+                }
+                k = k * 10 + (name[i] - '0');
+                if (k >= std::numeric_limits<int>::max() - fresh_var_base) {
+                    return std::nullopt;
+                }
+            }
+            return fresh_var_base + static_cast<int>(k);
+        }
+        else {
+            return std::nullopt;
+        }
+    }
+
     template <class T>
     TermPtr<T> Signature<T>::ast2term(const astparser::AST& ast) {
         
         auto head = register_symbol(ast.head);
 
         if (ast.children.size() == 0) {
-            return std::make_shared<Term<T>>(head);
+            return make_term(head);
         }
         else {
             ListArgs<T> args;
             for (const auto& child : ast.children) {
                 args.push_back(ast2term(child));
             }
-            return std::make_shared<Term<T>>(head, std::move(args));
+            return make_term(head, std::move(args));
         }
     }
 
     template <class T>
     astparser::AST Signature<T>::term2ast(TermPtr<T> term) const {
         astparser::AST ast;
-        ast.head = get_name(term->get_head());
+        _append_name(term->get_head(), ast.head);
         for (const auto& arg : term->get_args()) {
             ast.children.push_back(term2ast(arg));
         }
@@ -2,6 +2,8 @@
 
 #include "ualg.hpp"
 
+#include <sstream>
+
 using namespace ualg;
 using namespace std;
 
@@ -11,7 +13,7 @@ TEST(TermParsing, Basics1) {
     };
 
     auto actual_res = sig.parse("f");
-    auto expected_res = make_shared<const Term<string>>("f");
+    auto expected_res = make_raw_term<string>("f");
 
     EXPECT_EQ(*actual_res, *expected_res);
 }
@@ -22,7 +24,7 @@ TEST(TermParsing, Basics2) {
     };
 
     auto actual_res = sig.parse("f[g, g]");
-    auto expected_res = make_shared<const Term<string>>("f", vector{make_shared<const Term<string>>("g"), make_shared<const Term<string>>("g")});
+    auto expected_res = make_raw_term<string>("f", vector{make_raw_term<string>("g"), make_raw_term<string>("g")});
 
     EXPECT_EQ(*actual_res, *expected_res);
 }
@@ -33,7 +35,7 @@ TEST(TermParsing, AutomaticRegistration) {
     };
 
     auto actual_res = sig.parse("f[g, g]");
-    auto expected_res = make_shared<const Term<string>>("f", vector{make_shared<const Term<string>>("g"), make_shared<const Term<string>>("g")});
+    auto expected_res = make_raw_term<string>("f", vector{make_raw_term<string>("g"), make_raw_term<string>("g")});
 
     EXPECT_EQ(*actual_res, *expected_res);
 }
@@ -53,4 +55,69 @@ TEST(TermParsing, Term2Ast) {
     auto actual_res = sig.term2ast(term);
 
     EXPECT_EQ(actual_res, ast);
-}
\ No newline at end of file
+}
+
+TEST(TermParsing, IntSignature) {
+    auto sig = compile_string_sig({"f", "g"});
+
+    // many symbols, so that the name lookup table is extended several times
+    vector<int> heads;
+    for (int i = 0; i < 1000; ++i) {
+        heads.push_back(sig.register_symbol("x" + to_string(i)));
+    }
+    EXPECT_EQ(sig.get_symbol_num(), 1002);
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_EQ(sig.get_repr("x" + to_string(i)), heads[i]);
+        EXPECT_EQ(sig.get_name(heads[i]), "x" + to_string(i));
+    }
+    EXPECT_EQ(sig.register_symbol("x3"), heads[3]);
+    EXPECT_EQ(sig.find_repr("y"), nullopt);
+    EXPECT_EQ(sig.find_name(5000), nullopt);
+    EXPECT_THROW(sig.get_name(5000), std::out_of_range);
+    EXPECT_EQ(sig.find_name(-1), nullopt);
+#if UALG_DENSE_SIGNATURE
+    // the dense table indexes the names by the heads
+    EXPECT_THROW(sig.add_symbol("z", -1), std::runtime_error);
+    EXPECT_EQ(sig.find_repr("z"), nullopt);
+#endif
+
+    auto term = sig.parse("f[x1, g[x2, x999]]");
+    EXPECT_EQ(sig.term_to_string(term), "f[x1, g[x2, x999]]");
+    EXPECT_EQ(*sig.ast2term(sig.term2ast(term)), *term);
+}
+
+TEST(TermParsing, PrintOptions) {
+    auto sig = compile_string_sig({"f", "g", "a", "b"});
+    auto term = sig.parse("f[g[a, b], g[a, b], f[g[a, b], a, b, a]]");
+
+    EXPECT_EQ(sig.term_to_string(term), "f[g[a, b], g[a, b], f[g[a, b], a, b, a]]");
+
+    PrintOptions depth_options;
+    depth_options.max_depth = 2;
+    EXPECT_EQ(sig.term_to_string(term, depth_options), "f[g[a, b], g[a, b], f[..., a, b, a]]");
+
+    PrintOptions width_options;
+    width_options.max_width = 2;
+    EXPECT_EQ(sig.term_to_string(term, width_options), "f[g[a, b], g[a, b], ...(+1)]");
+
+    PrintOptions share_options;
+    share_options.share = true;
+    EXPECT_EQ(sig.term_to_string(term, share_options), "let #0 = g[a, b] in f[#0, #0, f[#0, a, b, a]]");
+
+    // the references in the elided parts are not counted
+    PrintOptions elided_options;
+    elided_options.share = true;
+    elided_options.max_width = 1;
+    EXPECT_EQ(sig.term_to_string(term, elided_options), "f[g[a, ...(+1)], ...(+2)]");
+    elided_options.max_width = 2;
+    EXPECT_EQ(sig.term_to_string(term, elided_options), "let #0 = g[a, b] in f[#0, #0, ...(+1)]");
+
+    elided_options.max_width = 0;
+    elided_options.max_depth = 2;
+    EXPECT_EQ(sig.term_to_string(sig.parse("f[f[g[a, b]], f[g[a, b]]]"), elided_options), "let #0 = f[...] in f[#0, #0]");
+    EXPECT_EQ(sig.term_to_string(sig.parse("f[g[a, b], f[a, g[a, b]]]"), elided_options), "f[g[a, b], f[a, ...]]");
+
+    ostringstream os;
+    sig.print_term(os, term, share_options);
+    EXPECT_EQ(os.str(), sig.term_to_string(term, share_options));
+}
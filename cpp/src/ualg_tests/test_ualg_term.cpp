@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 
+#include <unordered_set>
+
 #include "ualg.hpp"
 
 using namespace ualg;
@@ -9,20 +11,39 @@ using namespace std;
 // NormalTerm
 TEST(TestTerm, get_term_size) {
 
-    auto t = make_shared<const Term<string>>("t", vector<TermPtr<string>>{});
-    auto s = make_shared<const Term<string>>("s", vector<TermPtr<string>>{t});
-    auto r = make_shared<const Term<string>>("r", vector<TermPtr<string>>{t});
-    auto a = make_shared<const Term<string>>("&", vector<TermPtr<string>>{s, r});
+    auto t = make_raw_term<string>("t", vector<TermPtr<string>>{});
+    auto s = make_raw_term<string>("s", vector<TermPtr<string>>{t});
+    auto r = make_raw_term<string>("r", vector<TermPtr<string>>{t});
+    auto a = make_raw_term<string>("&", vector<TermPtr<string>>{s, r});
 
     EXPECT_EQ(a->get_term_size(), 5);
 }
 
+TEST(TestTerm, structure_info) {
+
+    auto t = make_raw_term<string>("t", vector<TermPtr<string>>{});
+    auto s = make_raw_term<string>("s", vector<TermPtr<string>>{t});
+    auto a = make_raw_term<string>("&", vector<TermPtr<string>>{s, t});
+
+    EXPECT_EQ(t->get_depth(), 1);
+    EXPECT_EQ(a->get_depth(), 3);
+
+    // the hash is structural, so it agrees with the interned term
+    auto a_interned = make_term<string>("&", {make_term<string>("s", {make_term<string>("t")}), make_term<string>("t")});
+    EXPECT_EQ(a->get_hash(), a_interned->get_hash());
+    EXPECT_NE(a->get_hash(), s->get_hash());
+
+    unordered_set<TermPtr<string>, TermPtrHash<string>, TermPtrEqual<string>> term_set{a, s};
+    EXPECT_EQ(term_set.count(a_interned), 1);
+    EXPECT_EQ(term_set.count(t), 0);
+}
+
 TEST(TestTerm, get_subterm) {
 
-    auto t = make_shared<const Term<string>>("t", vector<TermPtr<string>>{});
-    auto s = make_shared<const Term<string>>("s", vector<TermPtr<string>>{t});
-    auto r = make_shared<const Term<string>>("r", vector<TermPtr<string>>{t});
-    auto a = make_shared<const Term<string>>("&", vector<TermPtr<string>>{s, r});
+    auto t = make_raw_term<string>("t", vector<TermPtr<string>>{});
+    auto s = make_raw_term<string>("s", vector<TermPtr<string>>{t});
+    auto r = make_raw_term<string>("r", vector<TermPtr<string>>{t});
+    auto a = make_raw_term<string>("&", vector<TermPtr<string>>{s, r});
 
     auto subterm = a->get_subterm({0});
     EXPECT_EQ(subterm, s);
@@ -30,14 +51,242 @@ TEST(TestTerm, get_subterm) {
 
 TEST(TestTerm, replace_at) {
 
-    auto s = make_shared<const Term<string>>("s", vector<TermPtr<string>>{});
-    auto t = make_shared<const Term<string>>("t", vector<TermPtr<string>>{});
-    auto a = make_shared<const Term<string>>("&", vector<TermPtr<string>>{s, s});
+    auto s = make_raw_term<string>("s", vector<TermPtr<string>>{});
+    auto t = make_raw_term<string>("t", vector<TermPtr<string>>{});
+    auto a = make_raw_term<string>("&", vector<TermPtr<string>>{s, s});
 
     // replacement
     auto actual_res = a->replace_at({0}, t);
 
-    auto expected_res = make_shared<const Term<string>>("&", vector<TermPtr<string>>{t, s});
+    auto expected_res = make_raw_term<string>("&", vector<TermPtr<string>>{t, s});
 
     EXPECT_EQ(*actual_res, *expected_res);
-}
\ No newline at end of file
+}
+
+TEST(TestTerm, term_bank) {
+
+    auto t1 = make_term<string>("t");
+    auto t2 = make_term<string>("t");
+    auto s = make_term<string>("s");
+
+    // structurally equal terms are shared
+    EXPECT_EQ(t1, t2);
+    EXPECT_NE(t1, s);
+
+    auto a1 = make_term<string>("&", {t1, s});
+    auto a2 = make_term<string>("&", {t2, s});
+    EXPECT_EQ(a1, a2);
+    EXPECT_TRUE(a1->is_interned());
+
+    // terms constructed outside the bank are interned on demand
+    auto t_raw = make_raw_term<string>("t");
+    EXPECT_FALSE(t_raw->is_interned());
+    EXPECT_EQ(TermBank<string>::get_instance().intern(t_raw), t1);
+
+    auto a3 = make_term<string>("&", {t_raw, s});
+    EXPECT_EQ(a3, a1);
+
+    // replacement goes through the bank
+    EXPECT_EQ(a1->replace_at({1}, t2), make_term<string>("&", {t1, t1}));
+    EXPECT_EQ(*a1, *a2);
+    EXPECT_NE(*a1, *make_term<string>("&", {s, t1}));
+}
+
+
+TEST(TestTerm, term_bank_release) {
+
+    auto& bank = TermBank<string>::get_instance();
+    auto size = bank.size();
+    auto created = bank.created_num();
+    bank.reset_peak_size();
+    {
+        auto tmp = make_term<string>("tmp", {make_term<string>("x")});
+        EXPECT_EQ(bank.size(), size + 2);
+    }
+    // the terms remove themselves from the bank when released
+    EXPECT_EQ(bank.size(), size);
+    EXPECT_EQ(bank.peak_size(), size + 2);
+    EXPECT_EQ(bank.created_num(), created + 2);
+}
+
+TEST(TestTerm, term_pool_threads) {
+
+    auto& bank = TermBank<string>::get_instance();
+    auto size = bank.size();
+
+    // the terms are created in another thread and released in this one
+    vector<TermPtr<string>> terms;
+    std::thread worker([&]() {
+        for (int i = 0; i < 5000; i++) {
+            terms.push_back(make_term<string>("f", {make_term<string>("x" + to_string(i))}));
+        }
+    });
+    worker.join();
+
+    EXPECT_EQ(bank.size(), size + 10000);
+    terms.clear();
+    EXPECT_EQ(bank.size(), size);
+
+    // the released blocks are reused
+    auto term = make_term<string>("f", {make_term<string>("y")});
+    EXPECT_EQ(term->get_args()[0]->get_head(), "y");
+
+    // the terms are released in a thread that never allocates, and its blocks are handed over when it exits
+    unordered_set<const Term<string>*> released;
+    for (int i = 0; i < 5000; i++) {
+        terms.push_back(make_term<string>("h", {make_term<string>("w" + to_string(i))}));
+        released.insert(terms.back().get());
+    }
+    std::thread releaser([&]() {
+        terms.clear();
+    });
+    releaser.join();
+    EXPECT_EQ(bank.size(), size + 2);
+
+    // a new thread takes the handed-over blocks from the global list
+    int reused = 0;
+    std::thread reuser([&]() {
+        vector<TermPtr<string>> new_terms;
+        for (int i = 0; i < 5000; i++) {
+            new_terms.push_back(make_term<string>("h", {make_term<string>("v" + to_string(i))}));
+            reused += released.count(new_terms.back().get());
+        }
+    });
+    reuser.join();
+    EXPECT_GT(reused, 0);
+}
+
+TEST(TestTerm, term_bank_threads) {
+
+    auto& bank = TermBank<string>::get_instance();
+    auto size = bank.size();
+
+    // the threads creating the same terms at the same time get the same nodes, whichever stripes they are in
+    vector<vector<TermPtr<string>>> terms(4);
+    vector<std::thread> workers;
+    for (auto& res : terms) {
+        workers.emplace_back([&res]() {
+            for (int i = 0; i < 2000; i++) {
+                res.push_back(make_term<string>("g", {make_term<string>("z" + to_string(i))}));
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    for (int i = 0; i < 2000; i++) {
+        for (const auto& res : terms) {
+            EXPECT_EQ(res[i], terms[0][i]);
+        }
+    }
+    EXPECT_EQ(bank.size(), size + 4000);
+    terms.clear();
+    EXPECT_EQ(bank.size(), size);
+}
+
+TEST(TestTerm, small_args) {
+
+    vector<TermPtr<string>> leaves;
+    for (int i = 0; i < 5; i++) {
+        leaves.push_back(make_term<string>("x" + to_string(i)));
+    }
+
+    // inline and heap storage
+    for (int n = 0; n <= 5; n++) {
+        ListArgs<string> list(leaves.begin(), leaves.begin() + n);
+        auto term = make_term<string>("f", ListArgs<string>(list));
+        auto& args = term->get_args();
+        EXPECT_EQ(args.size(), n);
+        EXPECT_EQ(args.to_vector(), list);
+
+        TermArgs<string> copy = args;
+        TermArgs<string> moved = std::move(copy);
+        EXPECT_EQ(moved, args);
+        EXPECT_TRUE(copy.empty());
+
+        std::span<const TermPtr<string>> view = args;
+        EXPECT_EQ(view.size(), n);
+    }
+}
+
+TEST(TestTerm, visit_subterms) {
+
+    auto term = make_term<string>("f", {make_term<string>("g", {make_term<string>("a")}), make_term<string>("b")});
+
+    vector<string> heads;
+    visit_subterms<string>(*term, [&](TermRef<string> subterm) {
+        heads.push_back(subterm.get_head());
+        return subterm.get_head() != "g";
+    });
+
+    EXPECT_EQ(heads, (vector<string>{"f", "g", "b"}));
+}
+
+TEST(TestTerm, ref_count) {
+
+    auto term = make_term<string>("f", {make_term<string>("ref_count_x")});
+    EXPECT_EQ(term.use_count(), 1);
+
+    // the pointer obtained from the term itself shares the counter
+    auto self = term->get_subterm({});
+    EXPECT_EQ(self, term);
+    EXPECT_EQ(term.use_count(), 2);
+
+    {
+        auto copy = term;
+        EXPECT_EQ(term.use_count(), 3);
+    }
+    EXPECT_EQ(term.use_count(), 2);
+
+    // the same term is returned by the bank as long as it is alive
+    EXPECT_EQ(make_term<string>("f", {make_term<string>("ref_count_x")}), term);
+
+    auto& bank = TermBank<string>::get_instance();
+    auto size = bank.size();
+    self.reset();
+    term.reset();
+    EXPECT_EQ(bank.size(), size - 2);
+}
+
+TEST(TestTerm, term_cursor) {
+
+    auto a = make_term<string>("a");
+    auto b = make_term<string>("b");
+    auto root = make_term<string>("f", {make_term<string>("g", {a, b}), a});
+
+    TermCursor<string> cursor(root);
+    EXPECT_TRUE(cursor.is_root());
+
+    cursor.down(0);
+    cursor.down(1);
+    EXPECT_EQ(cursor.get_focus(), b);
+    EXPECT_EQ(cursor.get_pos(), (TermPos{0, 1}));
+
+    auto new_root = cursor.replace(a);
+    EXPECT_EQ(new_root, make_term<string>("f", {make_term<string>("g", {a, a}), a}));
+    EXPECT_EQ(new_root, root->replace_at({0, 1}, a));
+
+    cursor.up();
+    EXPECT_EQ(cursor.get_focus(), root->get_args()[0]);
+    cursor.up();
+    EXPECT_EQ(cursor.get_focus(), root);
+    EXPECT_EQ(cursor.replace(b), b);
+}
+
+TEST(TestTerm, head_mask) {
+
+    auto a = make_term<string>("a");
+    auto b = make_term<string>("b");
+    auto term = make_term<string>("f", {make_term<string>("g", {a}), b});
+
+    EXPECT_EQ(term->get_head_mask(), Term<string>::head_bit("f") | Term<string>::head_bit("g") | a->get_head_mask() | b->get_head_mask());
+    EXPECT_TRUE(term->may_contain("a"));
+    EXPECT_TRUE(term->may_contain("g"));
+    EXPECT_EQ(a->may_contain("b"), Term<string>::head_bit("a") == Term<string>::head_bit("b"));
+
+    // the consecutive int heads do not share the bits
+    for (int i = 0; i < 32; i++) {
+        EXPECT_FALSE(make_term<int>(i)->may_contain(i + 1));
+    }
+}